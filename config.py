@@ -2,6 +2,15 @@ def can_build(env, platform):
     return True
 
 
+def get_opts(platform):
+    from SCons.Variables import BoolVariable
+
+    return [
+        BoolVariable("ewbik_performance_monitors", "Time the EWBIK solver stages and report them as Performance monitors", False),
+        BoolVariable("ewbik_profiler_zones", "Compile the EWBIK solver's profiler zones, for EWBIK.start_profiler_trace", False),
+    ]
+
+
 def configure(env):
     pass
 
@@ -10,10 +19,12 @@ def get_doc_classes():
     return [
         "EWBIK",
         "IKBone3D",
+        "IKCompiledRig",
         "IKEffector3D",
         "IKBoneSegment",
         "IKEffectorTemplate",
         "IKKusudama",
+        "IKTargetStream",
     ]
 
 
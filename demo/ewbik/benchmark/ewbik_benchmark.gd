@@ -0,0 +1,212 @@
+extends SceneTree
+
+# Headless IK benchmark over the demo rigs.
+#
+# godot --headless --path demo --script res://ewbik/benchmark/ewbik_benchmark.gd -- \
+#	--copies=50 --frames=600 --output=user://ewbik_benchmark.json
+#
+# Every copy of every scene gets its pins' target nodes swept along a scripted path. The script calls update_ik itself,
+# so only the solver is timed, not rendering or the rest of the frame.
+
+const DEFAULT_SCENES = [
+	"res://ewbik/scenes/male.tscn",
+	"res://ewbik/scenes/female.tscn",
+	"res://ewbik/scenes/ewbik_test_rig.tscn",
+]
+const WARMUP_FRAMES = 10
+const COPY_SPACING = 2.0
+
+var scenes : Array = DEFAULT_SCENES
+var copies : int = 10
+var frames : int = 300
+var output_path : String = ""
+var delta : float = 1.0 / 60.0
+
+var runs : Array = []
+var run_index : int = 0
+var frame : int = 0
+var results : Array = []
+
+
+class Run:
+	var scene_path : String
+	var root : Node3D
+	var ewbiks : Array = []
+	# One entry per pin of every EWBIK: the target node, its start transform, the skeleton and the pinned bone.
+	var pins : Array = []
+	var frame_usec : Array = []
+	# Iterations solved by all the rigs together, per frame.
+	var frame_iterations : Array = []
+	var errors : Array = []
+
+
+func _initialize():
+	for argument in OS.get_cmdline_user_args():
+		var pair : PackedStringArray = argument.trim_prefix("--").split("=", true, 1)
+		var value : String = pair[1] if pair.size() > 1 else ""
+		match pair[0]:
+			"scenes":
+				scenes = Array(value.split(","))
+			"copies":
+				copies = value.to_int()
+			"frames":
+				frames = value.to_int()
+			"output":
+				output_path = value
+	for scene_path in scenes:
+		var run := Run.new()
+		run.scene_path = scene_path
+		runs.push_back(run)
+	if not runs.is_empty():
+		_start_run()
+
+
+func _start_run():
+	var run : Run = runs[run_index]
+	var packed_scene : PackedScene = load(run.scene_path)
+	if packed_scene == null:
+		push_error("Cannot load %s." % run.scene_path)
+		return
+	run.root = Node3D.new()
+	root.add_child(run.root)
+	for copy_i in copies:
+		var instance : Node3D = packed_scene.instantiate()
+		instance.position = Vector3(copy_i * COPY_SPACING, 0, 0)
+		run.root.add_child(instance)
+		for ewbik in instance.find_children("*", "EWBIK", true, false):
+			ewbik.enabled = false
+			ewbik.threaded_rebuild = false
+			run.ewbiks.push_back(ewbik)
+	frame = 0
+
+
+func _collect_pins(run : Run):
+	for ewbik in run.ewbiks:
+		var skeleton : Skeleton3D = ewbik.get_node_or_null(ewbik.skeleton_node_path)
+		if skeleton == null:
+			continue
+		for pin_i in ewbik.get_pin_count():
+			var target : Node3D = ewbik.get_node_or_null(ewbik.get_pin_nodepath(pin_i))
+			var bone : int = skeleton.find_bone(ewbik.get_pin_bone_name(pin_i))
+			if target == null or bone == -1:
+				continue
+			run.pins.push_back([target, target.global_transform, skeleton, bone])
+
+
+func _move_targets(run : Run):
+	var time : float = frame * delta
+	for pin_i in run.pins.size():
+		var pin : Array = run.pins[pin_i]
+		var start : Transform3D = pin[1]
+		var phase : float = time * 2.0 + pin_i * 0.37
+		var offset := Vector3(sin(phase), 0.5 * sin(phase * 1.7), cos(phase * 0.8)) * 0.15
+		pin[0].global_transform = Transform3D(start.basis.rotated(Vector3.UP, 0.3 * sin(phase)), start.origin + offset)
+
+
+func _measure_error(run : Run) -> float:
+	var error : float = 0.0
+	for pin in run.pins:
+		var skeleton : Skeleton3D = pin[2]
+		var bone_origin : Vector3 = (skeleton.global_transform * skeleton.get_bone_global_pose(pin[3])).origin
+		error += bone_origin.distance_to(pin[0].global_transform.origin)
+	return error / max(run.pins.size(), 1)
+
+
+func _process(_delta):
+	if run_index >= runs.size():
+		return true
+	var run : Run = runs[run_index]
+	if run.root == null:
+		run_index += 1
+		if run_index < runs.size():
+			_start_run()
+		return false
+	if frame < WARMUP_FRAMES:
+		# Builds the rigs, which is not what is being measured.
+		for ewbik in run.ewbiks:
+			ewbik.update_ik(delta)
+		frame += 1
+		if frame == WARMUP_FRAMES:
+			_collect_pins(run)
+		return false
+	_move_targets(run)
+	var start_usec : int = Time.get_ticks_usec()
+	for ewbik in run.ewbiks:
+		ewbik.update_ik(delta)
+	run.frame_usec.push_back(Time.get_ticks_usec() - start_usec)
+	var iterations : int = 0
+	for ewbik in run.ewbiks:
+		iterations += ewbik.get_last_solve_iterations()
+	run.frame_iterations.push_back(iterations)
+	run.errors.push_back(_measure_error(run))
+	frame += 1
+	if frame < WARMUP_FRAMES + frames:
+		return false
+	results.push_back(_summarize(run))
+	run.root.queue_free()
+	run_index += 1
+	if run_index < runs.size():
+		_start_run()
+		return false
+	_report()
+	return true
+
+
+func _percentile(sorted : Array, fraction : float) -> float:
+	if sorted.is_empty():
+		return 0.0
+	return sorted[clampi(int(ceil(fraction * sorted.size())) - 1, 0, sorted.size() - 1)]
+
+
+func _summarize(run : Run) -> Dictionary:
+	var sorted_usec : Array = run.frame_usec.duplicate()
+	sorted_usec.sort()
+	var sorted_iterations : Array = run.frame_iterations.duplicate()
+	sorted_iterations.sort()
+	var total_iterations : int = 0
+	for iterations in run.frame_iterations:
+		total_iterations += iterations
+	var bones : int = 0
+	for ewbik in run.ewbiks:
+		var skeleton : Skeleton3D = ewbik.get_node_or_null(ewbik.skeleton_node_path)
+		if skeleton != null:
+			bones += skeleton.get_bone_count()
+	var total_usec : int = 0
+	for usec in run.frame_usec:
+		total_usec += usec
+	return {
+		"scene": run.scene_path,
+		"rigs": run.ewbiks.size(),
+		"skeleton_bones": bones,
+		"pins": run.pins.size(),
+		"frames": run.frame_usec.size(),
+		"iterations_per_frame_mean": float(total_iterations) / max(run.frame_iterations.size(), 1),
+		"iterations_per_frame_p50": _percentile(sorted_iterations, 0.5),
+		"iterations_per_frame_p95": _percentile(sorted_iterations, 0.95),
+		"iterations_per_frame_p99": _percentile(sorted_iterations, 0.99),
+		"frame_usec_mean": float(total_usec) / max(run.frame_usec.size(), 1),
+		"frame_usec_p50": _percentile(sorted_usec, 0.5),
+		"frame_usec_p95": _percentile(sorted_usec, 0.95),
+		"frame_usec_p99": _percentile(sorted_usec, 0.99),
+		"rig_usec_p50": _percentile(sorted_usec, 0.5) / max(run.ewbiks.size(), 1),
+		"final_effector_error": run.errors.back() if not run.errors.is_empty() else 0.0,
+		"mean_effector_error": run.errors.reduce(func(sum, error): return sum + error, 0.0) / max(run.errors.size(), 1),
+	}
+
+
+func _report():
+	var report : String = JSON.stringify({
+		"engine": Engine.get_version_info().string,
+		"processor": OS.get_processor_name(),
+		"copies": copies,
+		"frames": frames,
+		"results": results,
+	}, "\t")
+	print(report)
+	if output_path.is_empty():
+		return
+	var file := FileAccess.open(output_path, FileAccess.WRITE)
+	if file == null:
+		push_error("Cannot write %s." % output_path)
+		return
+	file.store_string(report)
@@ -0,0 +1,241 @@
+extends SceneTree
+
+# Sweeps solver settings and reports which trade off solve time against effector error best.
+#
+# godot --headless --path demo --script res://ewbik/benchmark/ewbik_pareto.gd -- \
+#	--scene=res://ewbik/scenes/male.tscn --iterations=1,2,4,8,10,16 --damp=5,10,15,30 \
+#	--falloff=0,0.5,1 --priorities=0,0.5,1 --output=user://ewbik_pareto
+#
+# Without --recording the pins' target nodes are swept along the same scripted path as ewbik_benchmark.gd, from the
+# same rest pose, for every configuration. With --recording=path, a file written by EWBIK.start_recording on the first
+# EWBIK of the scene is replayed instead. --damp is in degrees; --priorities scales every pin's direction priorities.
+#
+# Writes <output>.csv with one row per configuration and <output>.json with the rows and the Pareto fronts: the
+# configurations no other configuration beats on both time and position error, and on both time and orientation error.
+
+const WARMUP_FRAMES = 10
+
+var scene_path : String = "res://ewbik/scenes/male.tscn"
+var recording_path : String = ""
+var iteration_counts : Array = [1, 2, 4, 8, 10, 16]
+var damps : Array = [5.0, 10.0, 15.0, 30.0]
+var falloffs : Array = []
+var priority_scales : Array = []
+var frames : int = 300
+var output_path : String = ""
+var delta : float = 1.0 / 60.0
+
+var scene : Node3D
+var ewbiks : Array = []
+# One entry per pin of every EWBIK: the target node, its start transform, the skeleton and the pinned bone.
+var pins : Array = []
+var base_falloffs : Array = []
+var base_priorities : Array = []
+
+
+func _float_list(value : String) -> Array:
+	return Array(value.split_floats(","))
+
+
+func _initialize():
+	for argument in OS.get_cmdline_user_args():
+		var pair : PackedStringArray = argument.trim_prefix("--").split("=", true, 1)
+		var value : String = pair[1] if pair.size() > 1 else ""
+		match pair[0]:
+			"scene":
+				scene_path = value
+			"recording":
+				recording_path = value
+			"iterations":
+				iteration_counts = Array(value.split_floats(",")).map(func(count): return int(count))
+			"damp":
+				damps = _float_list(value)
+			"falloff":
+				falloffs = _float_list(value)
+			"priorities":
+				priority_scales = _float_list(value)
+			"frames":
+				frames = value.to_int()
+			"output":
+				output_path = value
+	var packed_scene : PackedScene = load(scene_path)
+	if packed_scene == null:
+		push_error("Cannot load %s." % scene_path)
+		return
+	scene = packed_scene.instantiate()
+	root.add_child(scene)
+	for ewbik in scene.find_children("*", "EWBIK", true, false):
+		ewbik.enabled = false
+		ewbik.threaded_rebuild = false
+		ewbiks.push_back(ewbik)
+		var ewbik_falloffs : Array = []
+		var ewbik_priorities : Array = []
+		for pin_i in ewbik.get_pin_count():
+			ewbik_falloffs.push_back(ewbik.get_pin_depth_falloff(pin_i))
+			ewbik_priorities.push_back(ewbik.get_pin_direction_priorities(pin_i))
+		base_falloffs.push_back(ewbik_falloffs)
+		base_priorities.push_back(ewbik_priorities)
+	for ewbik in ewbiks:
+		ewbik.update_ik(delta)
+	_collect_pins()
+
+
+func _collect_pins():
+	for ewbik in ewbiks:
+		var skeleton : Skeleton3D = ewbik.get_node_or_null(ewbik.skeleton_node_path)
+		if skeleton == null:
+			continue
+		for pin_i in ewbik.get_pin_count():
+			var target : Node3D = ewbik.get_node_or_null(ewbik.get_pin_nodepath(pin_i))
+			var bone : int = skeleton.find_bone(ewbik.get_pin_bone_name(pin_i))
+			if target == null or bone == -1:
+				continue
+			pins.push_back([target, target.global_transform, skeleton, bone])
+
+
+func _configurations() -> Array:
+	# An empty sweep keeps the scene's own value.
+	var configurations : Array = []
+	for iterations in iteration_counts:
+		for damp in damps:
+			for falloff in falloffs if not falloffs.is_empty() else [null]:
+				for priority_scale in priority_scales if not priority_scales.is_empty() else [null]:
+					configurations.push_back({
+						"iterations": iterations,
+						"damp_degrees": damp,
+						"depth_falloff": falloff,
+						"priority_scale": priority_scale,
+					})
+	return configurations
+
+
+func _apply(configuration : Dictionary):
+	for ewbik_i in ewbiks.size():
+		var ewbik : EWBIK = ewbiks[ewbik_i]
+		ewbik.max_ik_iterations = configuration.iterations
+		ewbik.default_damp = deg_to_rad(configuration.damp_degrees)
+		for pin_i in ewbik.get_pin_count():
+			var falloff = configuration.depth_falloff
+			ewbik.set_pin_depth_falloff(pin_i, base_falloffs[ewbik_i][pin_i] if falloff == null else falloff)
+			var priority_scale = configuration.priority_scale
+			var priorities : Vector3 = base_priorities[ewbik_i][pin_i]
+			ewbik.set_pin_direction_priorities(pin_i, priorities if priority_scale == null else priorities * priority_scale)
+
+
+func _move_targets(frame : int):
+	var time : float = frame * delta
+	for pin_i in pins.size():
+		var pin : Array = pins[pin_i]
+		var start : Transform3D = pin[1]
+		var phase : float = time * 2.0 + pin_i * 0.37
+		var offset := Vector3(sin(phase), 0.5 * sin(phase * 1.7), cos(phase * 0.8)) * 0.15
+		pin[0].global_transform = Transform3D(start.basis.rotated(Vector3.UP, 0.3 * sin(phase)), start.origin + offset)
+
+
+func _measure_synthetic() -> Dictionary:
+	for pin in pins:
+		pin[2].reset_bone_poses()
+	# Rebuilds the rigs after the settings changed, which is not what is being measured.
+	_move_targets(0)
+	for warmup_i in WARMUP_FRAMES:
+		for ewbik in ewbiks:
+			ewbik.update_ik(delta)
+	for pin in pins:
+		pin[2].reset_bone_poses()
+	var total_usec : int = 0
+	var position_error : float = 0.0
+	var orientation_error : float = 0.0
+	for frame in frames:
+		_move_targets(frame)
+		var start_usec : int = Time.get_ticks_usec()
+		for ewbik in ewbiks:
+			ewbik.update_ik(delta)
+		total_usec += Time.get_ticks_usec() - start_usec
+		for pin in pins:
+			var skeleton : Skeleton3D = pin[2]
+			var tip : Transform3D = skeleton.global_transform * skeleton.get_bone_global_pose(pin[3])
+			var target : Transform3D = pin[0].global_transform
+			position_error += tip.origin.distance_to(target.origin)
+			orientation_error += tip.basis.get_rotation_quaternion().angle_to(target.basis.get_rotation_quaternion())
+	var samples : int = max(frames * pins.size(), 1)
+	return {
+		"frame_usec": float(total_usec) / max(frames, 1),
+		"position_error": position_error / samples,
+		"orientation_error": orientation_error / samples,
+	}
+
+
+func _measure_recording() -> Dictionary:
+	var replay : Dictionary = ewbiks[0].replay_recording(recording_path, ewbiks[0].max_ik_iterations)
+	if replay.is_empty():
+		return {}
+	return {
+		"frame_usec": replay.average_usec,
+		"position_error": replay.position_error,
+		"orientation_error": replay.orientation_error,
+	}
+
+
+func _pareto_front(rows : Array, error_key : String) -> Array:
+	var order : Array = range(rows.size())
+	order.sort_custom(func(a, b):
+		if rows[a].frame_usec != rows[b].frame_usec:
+			return rows[a].frame_usec < rows[b].frame_usec
+		return rows[a][error_key] < rows[b][error_key])
+	# Walking from the cheapest, a configuration is on the front when it beats every cheaper one on error.
+	var front : Array = []
+	var best_error : float = INF
+	for row_i in order:
+		if rows[row_i][error_key] < best_error:
+			best_error = rows[row_i][error_key]
+			front.push_back(row_i)
+	return front
+
+
+func _process(_delta):
+	if ewbiks.is_empty():
+		push_error("%s has no EWBIK node." % scene_path)
+		return true
+	var rows : Array = []
+	for configuration in _configurations():
+		_apply(configuration)
+		var measurement : Dictionary = _measure_recording() if not recording_path.is_empty() else _measure_synthetic()
+		if measurement.is_empty():
+			push_error("Cannot replay %s." % recording_path)
+			return true
+		configuration.merge(measurement)
+		rows.push_back(configuration)
+	var position_front : Array = _pareto_front(rows, "position_error")
+	var orientation_front : Array = _pareto_front(rows, "orientation_error")
+	_report(rows, position_front, orientation_front)
+	return true
+
+
+func _report(rows : Array, position_front : Array, orientation_front : Array):
+	var csv : PackedStringArray = ["iterations,damp_degrees,depth_falloff,priority_scale,frame_usec,position_error,orientation_error,pareto_position,pareto_orientation"]
+	for row_i in rows.size():
+		var row : Dictionary = rows[row_i]
+		csv.push_back("%d,%f,%s,%s,%f,%f,%f,%s,%s" % [row.iterations, row.damp_degrees,
+				"" if row.depth_falloff == null else str(row.depth_falloff),
+				"" if row.priority_scale == null else str(row.priority_scale),
+				row.frame_usec, row.position_error, row.orientation_error,
+				row_i in position_front, row_i in orientation_front])
+	var report : String = JSON.stringify({
+		"engine": Engine.get_version_info().string,
+		"processor": OS.get_processor_name(),
+		"scene": scene_path,
+		"recording": recording_path,
+		"frames": frames,
+		"results": rows,
+		"pareto_position": position_front.map(func(row_i): return rows[row_i]),
+		"pareto_orientation": orientation_front.map(func(row_i): return rows[row_i]),
+	}, "\t")
+	print("\n".join(csv))
+	if output_path.is_empty():
+		return
+	for file_output in [[output_path + ".csv", "\n".join(csv) + "\n"], [output_path + ".json", report]]:
+		var file := FileAccess.open(file_output[0], FileAccess.WRITE)
+		if file == null:
+			push_error("Cannot write %s." % file_output[0])
+			continue
+		file.store_string(file_output[1])
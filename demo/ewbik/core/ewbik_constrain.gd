@@ -32,32 +32,33 @@ func _run():
 	var bone_map : BoneMap = BoneMap.new()
 	bone_map.profile = profile
 	var bone_vrm_mapping : Dictionary
-	ewbik.max_ik_iterations = 10
-	var pin_i = 0
 	var bones = ["Root", "Hips", "LeftHand", "RightHand", "Head", "LeftFoot", "RightFoot"]
-	ewbik.pin_count = bones.size()
+	var pins : Array
 	for bone_name in bones:
-		var bone_index = skeleton.find_bone(bone_name)
 		var node_3d : Node3D = Node3D.new()
 		node_3d.name = bone_name
 		if root.find_child(node_3d.name) == null:
 			root.add_child(node_3d)
 		node_3d.owner = root
-		if bone_name ==  "Hips":
-			ewbik.set_pin_depth_falloff(pin_i, 1)
-		ewbik.set_pin_bone_name(pin_i, bone_name)
-		ewbik.set_pin_depth_falloff(pin_i, 0)
-		ewbik.set_pin_direction_priorities(pin_i, Vector3(0.25, 0, 0.25))
+		var pin : Dictionary = {
+			"name": bone_name,
+			"depth_falloff": 0,
+			"direction_priorities": Vector3(0.25, 0, 0.25),
+		}
+		pins.push_back(pin)
 		var bone_id = skeleton.find_bone(bone_name)
 		if bone_id == -1:
-			pin_i = pin_i + 1
 			continue
 		var bone_global_pose : Transform3D = skeleton.get_bone_global_rest(bone_id)
 		bone_global_pose = skeleton.transform * bone_global_pose
 		node_3d.global_transform = bone_global_pose
 		var path_string : String = "../" + str(skeleton.get_path_to(root)) + "/" + bone_name
-		ewbik.set_pin_nodepath(pin_i, NodePath(path_string))
-		pin_i = pin_i + 1
+		pin["target_node"] = NodePath(path_string)
+	# One call, so the rig is only rebuilt once on the next process tick.
+	ewbik.configure_from_dictionary({
+		"max_ik_iterations": 10,
+		"pins": pins,
+	})
 	var constraint_bones = ["LeftLowerArm", "RightLowerArm"]
 #	ewbik.constraint_count = constraint_bones.size()
 #	for constraint_i in ewbik.constraint_count:
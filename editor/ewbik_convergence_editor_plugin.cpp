@@ -0,0 +1,104 @@
+/*************************************************************************/
+/*  ewbik_convergence_editor_plugin.cpp                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ewbik_convergence_editor_plugin.h"
+
+#include "editor/editor_scale.h"
+
+void EWBIKConvergencePlot::set_ewbik(EWBIK *p_ewbik) {
+	ewbik_id = p_ewbik ? p_ewbik->get_instance_id() : ObjectID();
+	_refresh();
+}
+
+void EWBIKConvergencePlot::_refresh() {
+	EWBIK *ewbik = Object::cast_to<EWBIK>(ObjectDB::get_instance(ewbik_id));
+	curve = ewbik ? ewbik->get_convergence_curve() : PackedFloat32Array();
+	solve_count = ewbik ? ewbik->get_convergence_solve_count() : 0;
+	queue_redraw();
+}
+
+void EWBIKConvergencePlot::_notification(int p_what) {
+	switch (p_what) {
+		case NOTIFICATION_ENTER_TREE: {
+			set_process(true);
+		} break;
+		case NOTIFICATION_PROCESS: {
+			// The curve is averaged over many solves, a few updates a second are enough.
+			time_since_refresh += get_process_delta_time();
+			if (time_since_refresh >= 0.25) {
+				time_since_refresh = 0.0;
+				_refresh();
+			}
+		} break;
+		case NOTIFICATION_DRAW: {
+			const Ref<Font> font = get_theme_font(SNAME("font"), SNAME("Label"));
+			const int font_size = get_theme_font_size(SNAME("font_size"), SNAME("Label"));
+			const Color font_color = get_theme_color(SNAME("font_color"), SNAME("Label"));
+			const Rect2 rect = Rect2(Point2(), get_size());
+			draw_rect(rect, get_theme_color(SNAME("dark_color_2"), SNAME("Editor")));
+			const real_t text_height = font->get_height(font_size);
+			if (curve.size() < 2) {
+				draw_string(font, Point2(4 * EDSCALE, text_height), TTR("Set convergence_history_size to plot the error per iteration."), HORIZONTAL_ALIGNMENT_LEFT, rect.size.x - 8 * EDSCALE, font_size, font_color);
+				break;
+			}
+			float max_error = CMP_EPSILON;
+			for (float error : curve) {
+				max_error = MAX(max_error, error);
+			}
+			const Rect2 plot = rect.grow_individual(-4 * EDSCALE, -(text_height + 4 * EDSCALE), -4 * EDSCALE, -4 * EDSCALE);
+			Vector<Point2> points;
+			points.resize(curve.size());
+			for (int32_t iteration_i = 0; iteration_i < curve.size(); iteration_i++) {
+				const real_t x = plot.position.x + plot.size.x * iteration_i / (curve.size() - 1);
+				const real_t y = plot.position.y + plot.size.y * (1.0 - curve[iteration_i] / max_error);
+				points.write[iteration_i] = Point2(x, y);
+			}
+			draw_line(plot.position + Vector2(0, plot.size.y), plot.get_end(), font_color * Color(1, 1, 1, 0.5));
+			draw_polyline(points, get_theme_color(SNAME("accent_color"), SNAME("Editor")), 2 * EDSCALE, true);
+			const String label = vformat(TTR("Error per iteration, %d solves: %.4f to %.4f"), solve_count, curve[0], curve[curve.size() - 1]);
+			draw_string(font, Point2(4 * EDSCALE, text_height), label, HORIZONTAL_ALIGNMENT_LEFT, rect.size.x - 8 * EDSCALE, font_size, font_color);
+		} break;
+	}
+}
+
+EWBIKConvergencePlot::EWBIKConvergencePlot() {
+	set_custom_minimum_size(Size2(0, 120 * EDSCALE));
+	set_tooltip_text(TTR("Error summed over all pins after each solver iteration, averaged over the recorded solves."));
+}
+
+bool EditorInspectorPluginEWBIKConvergence::can_handle(Object *p_object) {
+	return Object::cast_to<EWBIK>(p_object) != nullptr;
+}
+
+void EditorInspectorPluginEWBIKConvergence::parse_end(Object *p_object) {
+	EWBIKConvergencePlot *plot = memnew(EWBIKConvergencePlot);
+	plot->set_ewbik(Object::cast_to<EWBIK>(p_object));
+	add_custom_control(plot);
+}
@@ -0,0 +1,66 @@
+/*************************************************************************/
+/*  ewbik_convergence_editor_plugin.h                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2022 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2022 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef EWBIK_CONVERGENCE_EDITOR_PLUGIN_H
+#define EWBIK_CONVERGENCE_EDITOR_PLUGIN_H
+
+#include "editor/editor_inspector.h"
+#include "scene/gui/control.h"
+
+#include "../src/ewbik.h"
+
+// Plots EWBIK::get_convergence_curve at the bottom of the EWBIK inspector.
+class EWBIKConvergencePlot : public Control {
+	GDCLASS(EWBIKConvergencePlot, Control);
+
+	ObjectID ewbik_id;
+	PackedFloat32Array curve;
+	int32_t solve_count = 0;
+	double time_since_refresh = 0.0;
+
+	void _refresh();
+
+protected:
+	void _notification(int p_what);
+
+public:
+	void set_ewbik(EWBIK *p_ewbik);
+	EWBIKConvergencePlot();
+};
+
+class EditorInspectorPluginEWBIKConvergence : public EditorInspectorPlugin {
+	GDCLASS(EditorInspectorPluginEWBIKConvergence, EditorInspectorPlugin);
+
+public:
+	virtual bool can_handle(Object *p_object) override;
+	virtual void parse_end(Object *p_object) override;
+};
+
+#endif // EWBIK_CONVERGENCE_EDITOR_PLUGIN_H
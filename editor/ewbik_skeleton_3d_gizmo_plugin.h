@@ -44,6 +44,7 @@
 #include "scene/resources/immediate_mesh.h"
 
 #include "../src/ewbik.h"
+#include "ewbik_convergence_editor_plugin.h"
 
 class Joint;
 class PhysicalBone3D;
@@ -86,6 +87,9 @@ public:
 	EditorPluginEWBIK() {
 		Ref<EWBIK3DGizmoPlugin> ewbik_gizmo_plugin = Ref<EWBIK3DGizmoPlugin>(memnew(EWBIK3DGizmoPlugin));
 		Node3DEditor::get_singleton()->add_gizmo_plugin(ewbik_gizmo_plugin);
+		Ref<EditorInspectorPluginEWBIKConvergence> convergence_inspector_plugin;
+		convergence_inspector_plugin.instantiate();
+		add_inspector_plugin(convergence_inspector_plugin);
 	}
 };
 
@@ -32,14 +32,23 @@
 
 #include "src/ewbik.h"
 #include "src/ik_bone_3d.h"
+#include "src/ik_compiled_rig.h"
 #include "src/ik_effector_3d.h"
 #include "src/ik_effector_template.h"
+#include "src/ik_iteration_budget.h"
+#include "src/ik_performance.h"
+#include "src/ik_profiler.h"
+#include "src/ik_solve_scheduler.h"
+#include "src/ik_target_stream.h"
 #include "src/kusudama.h"
 
 #ifdef TOOLS_ENABLED
 #include "editor/ewbik_skeleton_3d_gizmo_plugin.h"
 #endif
 
+static Ref<ResourceFormatLoaderIKCompiledRig> resource_loader_ik_compiled_rig;
+static Ref<ResourceFormatSaverIKCompiledRig> resource_saver_ik_compiled_rig;
+
 void initialize_ewbik_module(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		GDREGISTER_CLASS(IKEffectorTemplate);
@@ -48,6 +57,13 @@ void initialize_ewbik_module(ModuleInitializationLevel p_level) {
 		GDREGISTER_CLASS(IKEffector3D);
 		GDREGISTER_CLASS(IKBoneSegment);
 		GDREGISTER_CLASS(IKKusudama);
+		GDREGISTER_CLASS(IKCompiledRig);
+		GDREGISTER_CLASS(IKTargetStream);
+
+		resource_loader_ik_compiled_rig.instantiate();
+		ResourceLoader::add_resource_format_loader(resource_loader_ik_compiled_rig);
+		resource_saver_ik_compiled_rig.instantiate();
+		ResourceSaver::add_resource_format_saver(resource_saver_ik_compiled_rig);
 	}
 #ifdef TOOLS_ENABLED
 	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
@@ -60,4 +76,13 @@ void uninitialize_ewbik_module(ModuleInitializationLevel p_level) {
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
 		return;
 	}
+	ResourceLoader::remove_resource_format_loader(resource_loader_ik_compiled_rig);
+	resource_loader_ik_compiled_rig.unref();
+	ResourceSaver::remove_resource_format_saver(resource_saver_ik_compiled_rig);
+	resource_saver_ik_compiled_rig.unref();
+	IKCompiledRig::clear_cache();
+	IKPerformance::unregister_monitors();
+	IKProfiler::stop_chrome_trace();
+	IKIterationBudget::clear();
+	IKSolveScheduler::clear();
 }
@@ -29,8 +29,16 @@
 /*************************************************************************/
 
 #include "ewbik.h"
+#include "core/config/engine.h"
 #include "core/core_string_names.h"
+#include "core/os/os.h"
 #include "ik_bone_3d.h"
+#include "ik_compiled_rig.h"
+#include "ik_iteration_budget.h"
+#include "ik_performance.h"
+#include "ik_profiler.h"
+#include "ik_solve_scheduler.h"
+#include "ik_solver_counters.h"
 
 #ifdef TOOLS_ENABLED
 #include "editor/editor_node.h"
@@ -43,8 +51,9 @@ void EWBIK::set_pin_count(int32_t p_value) {
 	for (int32_t pin_i = p_value; pin_i-- > old_count;) {
 		pins.write[pin_i].instantiate();
 	}
+	_resize_pin_target_overrides();
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 int32_t EWBIK::get_pin_count() const {
@@ -62,7 +71,7 @@ void EWBIK::add_pin(const StringName &p_name, const NodePath &p_target_node) {
 	set_pin_bone(count, p_name);
 	set_pin_target_nodepath(count, p_target_node);
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 void EWBIK::set_pin_bone(int32_t p_pin_index, const String &p_bone) {
@@ -74,7 +83,7 @@ void EWBIK::set_pin_bone(int32_t p_pin_index, const String &p_bone) {
 	}
 	data->set_name(p_bone);
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 void EWBIK::set_pin_target_nodepath(int32_t p_pin_index, const NodePath &p_target_node) {
@@ -85,8 +94,7 @@ void EWBIK::set_pin_target_nodepath(int32_t p_pin_index, const NodePath &p_targe
 		pins.write[p_pin_index] = data;
 	}
 	data->set_target_node(p_target_node);
-	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	update_pin_target(p_pin_index);
 }
 
 NodePath EWBIK::get_pin_target_nodepath(int32_t p_pin_index) {
@@ -104,24 +112,383 @@ void EWBIK::remove_pin(int32_t p_index) {
 	pins.remove_at(p_index);
 	pin_count--;
 	pins.resize(pin_count);
+	if (p_index < pin_target_overrides.size()) {
+		pin_target_overrides.remove_at(p_index);
+		pin_target_override_transforms.remove_at(p_index);
+	}
+	_resize_pin_target_overrides();
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
-void EWBIK::update_shadow_bones_transform() {
+void EWBIK::update_shadow_bones_transform(Skeleton3D *p_skeleton) {
+	ERR_FAIL_NULL(p_skeleton);
+	// Gather every input pose before touching the shadow skeleton. The chain's root takes its global pose; every other bone
+	// has the same parent in both skeletons and takes its local pose.
+	input_pose_buffer.resize(bone_list.size());
+	Transform3D *input_poses = input_pose_buffer.ptrw();
 	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
-		Ref<IKBone3D> bone = bone_list[bone_i];
-		if (bone.is_null()) {
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
+		if (bone.is_null() || bone->get_bone_id() == -1) {
+			continue;
+		}
+		if (bone->get_parent().is_null()) {
+			input_poses[bone_i] = p_skeleton->get_transform() * p_skeleton->get_bone_global_pose(bone->get_bone_id());
+		} else {
+			input_poses[bone_i] = p_skeleton->get_bone_pose(bone->get_bone_id());
+		}
+	}
+	_write_shadow_bone_poses(input_poses);
+	_update_pin_targets(p_skeleton);
+}
+
+void EWBIK::_update_pin_targets(Skeleton3D *p_skeleton) {
+	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
+		if (bone.is_null() || !bone->is_pinned()) {
 			continue;
 		}
-		bone->set_initial_pose(get_skeleton());
-		if (bone->is_pinned()) {
-			bone->get_pin()->update_target_global_transform(get_skeleton(), this);
+		Ref<IKEffector3D> pin = bone->get_pin();
+		if (target_node_caches_dirty) {
+			pin->invalidate_target_node_cache();
 		}
+		pin->update_target_global_transform(p_skeleton, this);
 	}
+	target_node_caches_dirty = false;
 }
 
-void EWBIK::update_skeleton_bones_transform() {
+void EWBIK::_write_shadow_bone_poses(const Transform3D *p_input_poses) {
+	// Write them back parents first. Setting the root's global pose already invalidates every global transform below it,
+	// so the other bones only need their local pose replaced.
+	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
+		if (bone.is_null() || bone->get_bone_id() == -1) {
+			continue;
+		}
+		if (bone->get_parent().is_null()) {
+			bone->set_global_pose(p_input_poses[bone_i]);
+		} else {
+			bone->set_pose_unpropagated(p_input_poses[bone_i]);
+		}
+	}
+}
+
+void EWBIK::_read_shadow_bone_poses(Transform3D *r_poses) const {
+	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
+		if (bone.is_null() || bone->get_bone_id() == -1) {
+			continue;
+		}
+		r_poses[bone_i] = bone->get_parent().is_null() ? bone->get_global_pose() : bone->get_pose();
+	}
+}
+
+void EWBIK::_get_pinned_effectors(Vector<Ref<IKEffector3D>> &r_effectors) const {
+	r_effectors.clear();
+	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
+		if (bone.is_valid() && bone->is_pinned()) {
+			r_effectors.push_back(bone->get_pin());
+		}
+	}
+}
+
+Error EWBIK::start_recording(const String &p_path) {
+	stop_recording();
+	Skeleton3D *skeleton = get_skeleton();
+	ERR_FAIL_NULL_V(skeleton, ERR_UNCONFIGURED);
+	ERR_FAIL_COND_V_MSG(segmented_skeleton.is_null(), ERR_UNCONFIGURED, "The IK rig has not been built yet.");
+	Vector<Ref<IKEffector3D>> effectors;
+	_get_pinned_effectors(effectors);
+	return recording.begin_write(p_path, IKCompiledRig::hash_skeleton(skeleton), bone_list.size(), effectors.size());
+}
+
+void EWBIK::stop_recording() {
+	recording.close();
+}
+
+bool EWBIK::is_recording() const {
+	return recording.is_open();
+}
+
+void EWBIK::_record_frame(real_t p_delta, const IKTargetRecording::FrameSolve &p_solve, const Transform3D &p_root_parent) {
+	Vector<Ref<IKEffector3D>> effectors;
+	_get_pinned_effectors(effectors);
+	if (bone_list.size() != recording.get_bone_count() || effectors.size() != recording.get_effector_count()) {
+		WARN_PRINT("The IK rig changed while recording; the recording was stopped.");
+		stop_recording();
+		return;
+	}
+	// The shadow bones hold the pose the solve starts from, which an amortized solve carried over from the last frame.
+	recording_poses.resize(bone_list.size());
+	_read_shadow_bone_poses(recording_poses.ptrw());
+	recording_targets.resize(effectors.size());
+	Transform3D *targets = recording_targets.ptrw();
+	for (int32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		targets[effector_i] = effectors[effector_i]->get_target_global_transform();
+	}
+	recording.write_frame(p_delta, p_solve, p_root_parent, recording_poses.ptr(), targets);
+}
+
+Dictionary EWBIK::replay_recording(const String &p_path, int32_t p_iterations) {
+	Dictionary result;
+	Skeleton3D *skeleton = get_skeleton();
+	ERR_FAIL_NULL_V(skeleton, result);
+	if (is_dirty || segmented_skeleton.is_null()) {
+		rebuild();
+	}
+	ERR_FAIL_COND_V(segmented_skeleton.is_null() || !bone_list.size(), result);
+	IKTargetRecording replay;
+	ERR_FAIL_COND_V(replay.open(p_path) != OK, result);
+	Vector<Ref<IKEffector3D>> effectors;
+	_get_pinned_effectors(effectors);
+	ERR_FAIL_COND_V_MSG(replay.get_skeleton_hash() != IKCompiledRig::hash_skeleton(skeleton), result, "The recording was made on a different skeleton.");
+	ERR_FAIL_COND_V_MSG(replay.get_bone_count() != bone_list.size() || replay.get_effector_count() != effectors.size(), result, "The recording was made with a different IK rig.");
+	// The root bone hangs off root_transform. The bone list runs from the tips, so its first bone is not the root.
+	ERR_FAIL_NULL_V(root_transform, result);
+	Vector<Transform3D> input_poses;
+	input_poses.resize(bone_list.size());
+	Vector<Transform3D> targets;
+	targets.resize(effectors.size());
+	Transform3D root_parent;
+	double delta = 0.0;
+	IKTargetRecording::FrameSolve solve;
+	int64_t frame_count = 0;
+	uint64_t total_usec = 0;
+	double position_error = 0.0;
+	double orientation_error = 0.0;
+	// Only the solve is timed. The shadow skeleton keeps the last replayed pose until the next execute overwrites it.
+	while (replay.read_frame(delta, solve, root_parent, input_poses.ptrw(), targets.ptrw())) {
+		if (p_iterations >= 0) {
+			solve.iterations = p_iterations;
+			solve.schedule_start = 0;
+			solve.schedule_iterations = p_iterations;
+		}
+		root_transform->set_global_transform(root_parent);
+		_write_shadow_bone_poses(input_poses.ptr());
+		for (int32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+			effectors.write[effector_i]->set_target_global_transform(targets[effector_i]);
+		}
+		const uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+		for (int32_t i = 0; i < solve.iterations; i++) {
+			const real_t damp = IKBoneSegment::get_scheduled_damp(initial_damp, get_default_damp(), solve.schedule_start + i, solve.schedule_iterations);
+			if (!segmented_skeleton->segment_solver(damp, segment_tolerance)) {
+				break;
+			}
+		}
+		total_usec += OS::get_singleton()->get_ticks_usec() - start_usec;
+		for (int32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+			const Transform3D tip = effectors[effector_i]->get_shadow_bone()->get_global_pose();
+			position_error += tip.origin.distance_to(targets[effector_i].origin);
+			orientation_error += tip.basis.get_rotation_quaternion().angle_to(targets[effector_i].basis.get_rotation_quaternion());
+		}
+		frame_count++;
+	}
+	// The replay left its own pose on the shadow skeleton, so an amortized solve has to start over from the skeleton.
+	amortized_pose_valid = false;
+	const int64_t sample_count = frame_count * effectors.size();
+	result["frames"] = frame_count;
+	result["total_usec"] = total_usec;
+	result["average_usec"] = frame_count ? double(total_usec) / frame_count : 0.0;
+	result["position_error"] = sample_count ? position_error / sample_count : 0.0;
+	result["orientation_error"] = sample_count ? orientation_error / sample_count : 0.0;
+	return result;
+}
+
+float *EWBIK::_begin_convergence_solve() {
+	if (convergence_history_size <= 0) {
+		return nullptr;
+	}
+	if (convergence_iteration_count != max_ik_iterations || convergence_pin_count != pin_effectors.size()) {
+		convergence_iteration_count = max_ik_iterations;
+		convergence_pin_count = pin_effectors.size();
+		clear_convergence_history();
+	}
+	if (convergence_pin_count == 0) {
+		return nullptr;
+	}
+	return convergence_history.ptrw() + convergence_next_solve * convergence_iteration_count * convergence_pin_count;
+}
+
+void EWBIK::_sample_convergence(float *r_row) const {
+	for (int32_t pin_i = 0; pin_i < convergence_pin_count; pin_i++) {
+		const Ref<IKEffector3D> &effector = pin_effectors[pin_i];
+		r_row[pin_i] = effector.is_valid() ? effector->get_weighted_error() : 0.0f;
+	}
+}
+
+void EWBIK::_end_convergence_solve() {
+	convergence_next_solve = (convergence_next_solve + 1) % convergence_history_size;
+	convergence_solve_count = MIN(convergence_solve_count + 1, convergence_history_size);
+}
+
+void EWBIK::set_convergence_history_size(int32_t p_size) {
+	ERR_FAIL_COND(p_size < 0);
+	convergence_history_size = p_size;
+	clear_convergence_history();
+}
+
+int32_t EWBIK::get_convergence_history_size() const {
+	return convergence_history_size;
+}
+
+void EWBIK::clear_convergence_history() {
+	convergence_history.resize(convergence_history_size * convergence_iteration_count * convergence_pin_count);
+	convergence_next_solve = 0;
+	convergence_solve_count = 0;
+}
+
+int32_t EWBIK::get_convergence_solve_count() const {
+	return convergence_solve_count;
+}
+
+PackedFloat32Array EWBIK::get_convergence_solve(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, convergence_solve_count, PackedFloat32Array());
+	const int32_t solve_size = convergence_iteration_count * convergence_pin_count;
+	const int32_t oldest_solve = convergence_solve_count < convergence_history_size ? 0 : convergence_next_solve;
+	const int32_t solve_i = (oldest_solve + p_index) % convergence_history_size;
+	return convergence_history.slice(solve_i * solve_size, (solve_i + 1) * solve_size);
+}
+
+PackedFloat32Array EWBIK::get_convergence_curve() const {
+	PackedFloat32Array curve;
+	if (!convergence_solve_count) {
+		return curve;
+	}
+	curve.resize(convergence_iteration_count);
+	float *w = curve.ptrw();
+	const float *r = convergence_history.ptr();
+	for (int32_t iteration_i = 0; iteration_i < convergence_iteration_count; iteration_i++) {
+		float sum = 0.0f;
+		for (int32_t solve_i = 0; solve_i < convergence_solve_count; solve_i++) {
+			const float *row = r + (solve_i * convergence_iteration_count + iteration_i) * convergence_pin_count;
+			for (int32_t pin_i = 0; pin_i < convergence_pin_count; pin_i++) {
+				sum += row[pin_i];
+			}
+		}
+		w[iteration_i] = sum / convergence_solve_count;
+	}
+	return curve;
+}
+
+Error EWBIK::start_profiler_trace(const String &p_path) {
+	return IKProfiler::start_chrome_trace(p_path);
+}
+
+void EWBIK::stop_profiler_trace() {
+	IKProfiler::stop_chrome_trace();
+}
+
+void EWBIK::_add_solver_counters(const IKSolverCounters &p_counters) {
+	solver_counters.add(p_counters);
+	IKSolverCounters::add_to_global(p_counters);
+}
+
+Dictionary EWBIK::get_solver_stats() const {
+	return solver_counters.to_dictionary();
+}
+
+void EWBIK::reset_solver_stats() {
+	solver_counters = IKSolverCounters();
+}
+
+Dictionary EWBIK::get_global_solver_stats() {
+	return IKSolverCounters::get_global_dictionary();
+}
+
+void EWBIK::reset_global_solver_stats() {
+	IKSolverCounters::reset_global();
+}
+
+Dictionary EWBIK::get_memory_usage() const {
+	IKBoneSegment::MemoryUsage usage;
+	if (segmented_skeleton.is_valid()) {
+		segmented_skeleton->get_memory_usage(usage);
+	}
+	uint64_t buffers = input_pose_buffer.size() * sizeof(Transform3D) + convergence_history.size() * sizeof(float);
+	buffers += bone_list.size() * sizeof(Ref<IKBone3D>) + pin_effectors.size() * sizeof(Ref<IKEffector3D>);
+	buffers += (pin_target_override_transforms.size() + stream_targets.size() + recording_poses.size() + recording_targets.size()) * sizeof(Transform3D);
+	buffers += pin_target_overrides.size() * sizeof(IKEffector3D::TargetOverride);
+	usage.transforms += root_transform.is_valid() ? root_transform->get_memory_usage() : 0;
+	Dictionary result;
+	result["segments"] = usage.segments;
+	result["bones"] = usage.bones;
+	result["transforms"] = usage.transforms;
+	result["headings"] = usage.headings;
+	result["constraints"] = usage.constraints;
+	result["shared_constraints"] = usage.shared_constraints;
+	result["buffers"] = buffers;
+	result["total"] = usage.segments + usage.bones + usage.transforms + usage.headings + usage.constraints + buffers;
+	return result;
+}
+
+void EWBIK::_resize_pin_target_overrides() {
+	const int32_t old_size = pin_target_overrides.size();
+	pin_target_overrides.resize(pins.size());
+	pin_target_override_transforms.resize(pins.size());
+	for (int32_t pin_i = old_size; pin_i < pin_target_overrides.size(); pin_i++) {
+		pin_target_overrides.write[pin_i] = IKEffector3D::TARGET_OVERRIDE_NONE;
+	}
+}
+
+void EWBIK::_pull_target_stream() {
+	if (target_stream.is_null() || !target_stream->pop_latest(stream_targets)) {
+		return;
+	}
+	_resize_pin_target_overrides();
+	const int32_t target_count = MIN(stream_targets.size(), pins.size());
+	for (int32_t pin_i = 0; pin_i < target_count; pin_i++) {
+		_set_pin_target_override(pin_i, IKEffector3D::TARGET_OVERRIDE_TRANSFORM, stream_targets[pin_i]);
+	}
+}
+
+void EWBIK::set_target_stream(const Ref<IKTargetStream> &p_target_stream) {
+	target_stream = p_target_stream;
+}
+
+Ref<IKTargetStream> EWBIK::get_target_stream() const {
+	return target_stream;
+}
+
+void EWBIK::_set_pin_target_override(int32_t p_pin_index, IKEffector3D::TargetOverride p_override, const Transform3D &p_transform) {
+	pin_target_overrides.write[p_pin_index] = p_override;
+	pin_target_override_transforms.write[p_pin_index] = p_transform;
+	if (p_pin_index < pin_effectors.size() && pin_effectors[p_pin_index].is_valid()) {
+		pin_effectors[p_pin_index]->set_target_override(p_override, p_transform);
+	}
+}
+
+void EWBIK::set_pin_target_transforms(const PackedFloat32Array &p_transforms) {
+	ERR_FAIL_COND_MSG(p_transforms.size() != pins.size() * 12, vformat("Expected %d floats, 12 for each pin.", pins.size() * 12));
+	_resize_pin_target_overrides();
+	const float *r = p_transforms.ptr();
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		_set_pin_target_override(pin_i, IKEffector3D::TARGET_OVERRIDE_TRANSFORM, IKEffector3D::transform_from_floats(r + pin_i * 12));
+	}
+}
+
+void EWBIK::set_pin_target_positions(const PackedVector3Array &p_positions) {
+	ERR_FAIL_COND_MSG(p_positions.size() != pins.size(), vformat("Expected %d positions, one for each pin.", pins.size()));
+	_resize_pin_target_overrides();
+	const Vector3 *r = p_positions.ptr();
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		_set_pin_target_override(pin_i, IKEffector3D::TARGET_OVERRIDE_POSITION, Transform3D(Basis(), r[pin_i]));
+	}
+}
+
+void EWBIK::clear_pin_target_overrides() {
+	for (int32_t pin_i = 0; pin_i < pin_target_overrides.size(); pin_i++) {
+		_set_pin_target_override(pin_i, IKEffector3D::TARGET_OVERRIDE_NONE, Transform3D());
+	}
+}
+
+void EWBIK::_on_tree_changed() {
+	target_node_caches_dirty = true;
+}
+
+void EWBIK::update_skeleton_bones_transform(Skeleton3D *p_skeleton) {
+	ERR_FAIL_NULL(p_skeleton);
+	// The chain's root goes first, so the only global pose read back from the skeleton happens before any bone is written.
 	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
 		Ref<IKBone3D> bone = bone_list[bone_i];
 		if (bone.is_null()) {
@@ -130,7 +497,7 @@ void EWBIK::update_skeleton_bones_transform() {
 		if (bone->get_bone_id() == -1) {
 			continue;
 		}
-		bone->set_skeleton_bone_pose(get_skeleton(), 1.0);
+		bone->set_skeleton_bone_pose(p_skeleton, 1.0);
 	}
 }
 
@@ -402,7 +769,7 @@ void EWBIK::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_kusudama_limit_cone_radius", "index", "cone_index", "radius"), &EWBIK::set_kusudama_limit_cone_radius);
 	ClassDB::bind_method(D_METHOD("get_kusudama_limit_cone_radius", "index", "cone_index"), &EWBIK::get_kusudama_limit_cone_radius);
 	ClassDB::bind_method(D_METHOD("set_kusudama_limit_cone_center", "index", "cone_index", "center"), &EWBIK::set_kusudama_limit_cone_center);
-	ClassDB::bind_method(D_METHOD("get_kusudama_limit_cone_center", "index", "cone_index"), &EWBIK::set_kusudama_limit_cone_center);
+	ClassDB::bind_method(D_METHOD("get_kusudama_limit_cone_center", "index", "cone_index"), &EWBIK::get_kusudama_limit_cone_center);
 	ClassDB::bind_method(D_METHOD("set_kusudama_limit_cone_count", "index", "count"), &EWBIK::set_kusudama_limit_cone_count);
 	ClassDB::bind_method(D_METHOD("get_kusudama_limit_cone_count", "index"), &EWBIK::get_kusudama_limit_cone_count);
 	ClassDB::bind_method(D_METHOD("set_kusudama_twist", "index", "name"), &EWBIK::set_kusudama_twist);
@@ -424,31 +791,84 @@ void EWBIK::_bind_methods() {
 			&EWBIK::remove_pin);
 	ClassDB::bind_method(D_METHOD("get_pin_bone_name", "index"), &EWBIK::get_pin_bone_name);
 	ClassDB::bind_method(D_METHOD("set_pin_bone_name", "index", "name"), &EWBIK::set_pin_bone_name);
+	ClassDB::bind_method(D_METHOD("get_pin_weight", "index"), &EWBIK::get_pin_weight);
+	ClassDB::bind_method(D_METHOD("set_pin_weight", "index", "weight"), &EWBIK::set_pin_weight);
 	ClassDB::bind_method(D_METHOD("get_pin_direction_priorities", "index"), &EWBIK::get_pin_direction_priorities);
 	ClassDB::bind_method(D_METHOD("set_pin_direction_priorities", "index", "priority"), &EWBIK::set_pin_direction_priorities);
 	ClassDB::bind_method(D_METHOD("set_debug_skeleton", "enable"), &EWBIK::set_debug_skeleton);
 	ClassDB::bind_method(D_METHOD("get_default_damp"), &EWBIK::get_default_damp);
 	ClassDB::bind_method(D_METHOD("set_default_damp", "damp"), &EWBIK::set_default_damp);
+	ClassDB::bind_method(D_METHOD("get_initial_damp"), &EWBIK::get_initial_damp);
+	ClassDB::bind_method(D_METHOD("set_initial_damp", "damp"), &EWBIK::set_initial_damp);
 	ClassDB::bind_method(D_METHOD("get_kusudama_flip_handedness", "enable"), &EWBIK::get_kusudama_flip_handedness);
 	ClassDB::bind_method(D_METHOD("get_pin_nodepath"), &EWBIK::get_pin_nodepath);
 	ClassDB::bind_method(D_METHOD("set_pin_nodepath", "index", "nodepath"), &EWBIK::set_pin_nodepath);
 	ClassDB::bind_method(D_METHOD("get_enabled"), &EWBIK::get_enabled);
 	ClassDB::bind_method(D_METHOD("set_enabled", "enabled"), &EWBIK::set_enabled);
+	ClassDB::bind_method(D_METHOD("update_ik", "delta"), &EWBIK::update_ik);
 	ClassDB::bind_method(D_METHOD("get_skeleton_node_path"), &EWBIK::get_skeleton_node_path);
 	ClassDB::bind_method(D_METHOD("set_skeleton_node_path", "node_path"), &EWBIK::set_skeleton_node_path);
+	ClassDB::bind_method(D_METHOD("rebuild"), &EWBIK::rebuild);
+	ClassDB::bind_method(D_METHOD("is_rebuilding"), &EWBIK::is_rebuilding);
+	ClassDB::bind_method(D_METHOD("get_compiled_rig"), &EWBIK::get_compiled_rig);
+	ClassDB::bind_method(D_METHOD("set_pin_target_transforms", "transforms"), &EWBIK::set_pin_target_transforms);
+	ClassDB::bind_method(D_METHOD("set_pin_target_positions", "positions"), &EWBIK::set_pin_target_positions);
+	ClassDB::bind_method(D_METHOD("clear_pin_target_overrides"), &EWBIK::clear_pin_target_overrides);
+	ClassDB::bind_method(D_METHOD("set_target_stream", "target_stream"), &EWBIK::set_target_stream);
+	ClassDB::bind_method(D_METHOD("get_target_stream"), &EWBIK::get_target_stream);
+	ClassDB::bind_method(D_METHOD("start_recording", "path"), &EWBIK::start_recording);
+	ClassDB::bind_method(D_METHOD("stop_recording"), &EWBIK::stop_recording);
+	ClassDB::bind_method(D_METHOD("is_recording"), &EWBIK::is_recording);
+	ClassDB::bind_method(D_METHOD("replay_recording", "path", "iterations"), &EWBIK::replay_recording, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("set_convergence_history_size", "size"), &EWBIK::set_convergence_history_size);
+	ClassDB::bind_method(D_METHOD("get_convergence_history_size"), &EWBIK::get_convergence_history_size);
+	ClassDB::bind_method(D_METHOD("get_convergence_solve_count"), &EWBIK::get_convergence_solve_count);
+	ClassDB::bind_method(D_METHOD("get_convergence_solve", "index"), &EWBIK::get_convergence_solve);
+	ClassDB::bind_method(D_METHOD("get_convergence_curve"), &EWBIK::get_convergence_curve);
+	ClassDB::bind_method(D_METHOD("clear_convergence_history"), &EWBIK::clear_convergence_history);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("start_profiler_trace", "path"), &EWBIK::start_profiler_trace);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("stop_profiler_trace"), &EWBIK::stop_profiler_trace);
+	ClassDB::bind_method(D_METHOD("get_solver_stats"), &EWBIK::get_solver_stats);
+	ClassDB::bind_method(D_METHOD("get_memory_usage"), &EWBIK::get_memory_usage);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("set_iteration_budget_msec", "msec"), &EWBIK::set_iteration_budget_msec);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("get_iteration_budget_msec"), &EWBIK::get_iteration_budget_msec);
+	ClassDB::bind_method(D_METHOD("get_last_solve_iterations"), &EWBIK::get_last_solve_iterations);
+	ClassDB::bind_method(D_METHOD("set_iterations_per_frame", "iterations"), &EWBIK::set_iterations_per_frame);
+	ClassDB::bind_method(D_METHOD("get_iterations_per_frame"), &EWBIK::get_iterations_per_frame);
+	ClassDB::bind_method(D_METHOD("restart_amortized_solve"), &EWBIK::restart_amortized_solve);
+	ClassDB::bind_method(D_METHOD("set_segment_tolerance", "tolerance"), &EWBIK::set_segment_tolerance);
+	ClassDB::bind_method(D_METHOD("get_segment_tolerance"), &EWBIK::get_segment_tolerance);
+	ClassDB::bind_method(D_METHOD("set_solve_interval", "interval"), &EWBIK::set_solve_interval);
+	ClassDB::bind_method(D_METHOD("get_solve_interval"), &EWBIK::get_solve_interval);
+	ClassDB::bind_method(D_METHOD("reset_solver_stats"), &EWBIK::reset_solver_stats);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("get_global_solver_stats"), &EWBIK::get_global_solver_stats);
+	ClassDB::bind_static_method("EWBIK", D_METHOD("reset_global_solver_stats"), &EWBIK::reset_global_solver_stats);
+	ClassDB::bind_method(D_METHOD("set_baked_rig", "baked_rig"), &EWBIK::set_baked_rig);
+	ClassDB::bind_method(D_METHOD("get_baked_rig"), &EWBIK::get_baked_rig);
+	ClassDB::bind_method(D_METHOD("set_threaded_rebuild", "threaded_rebuild"), &EWBIK::set_threaded_rebuild);
+	ClassDB::bind_method(D_METHOD("get_threaded_rebuild"), &EWBIK::get_threaded_rebuild);
+	ClassDB::bind_method(D_METHOD("configure_from_dictionary", "configuration"), &EWBIK::configure_from_dictionary);
 
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "enabled"), "set_enabled", "get_enabled");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "baked_rig", PROPERTY_HINT_RESOURCE_TYPE, "IKCompiledRig"), "set_baked_rig", "get_baked_rig");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "threaded_rebuild"), "set_threaded_rebuild", "get_threaded_rebuild");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "convergence_history_size", PROPERTY_HINT_RANGE, "0,600,1,or_greater"), "set_convergence_history_size", "get_convergence_history_size");
 	ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "skeleton_node_path"), "set_skeleton_node_path", "get_skeleton_node_path");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "root_bone", PROPERTY_HINT_ENUM_SUGGESTION), "set_root_bone", "get_root_bone");
 	ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "tip_bone", PROPERTY_HINT_ENUM_SUGGESTION), "set_tip_bone", "get_tip_bone");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_ik_iterations", PROPERTY_HINT_RANGE, "1,150,1,or_greater"), "set_max_ik_iterations", "get_max_ik_iterations");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "iterations_per_frame", PROPERTY_HINT_RANGE, "0,150,1,or_greater"), "set_iterations_per_frame", "get_iterations_per_frame");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "segment_tolerance", PROPERTY_HINT_RANGE, "0,1,0.0001,or_greater"), "set_segment_tolerance", "get_segment_tolerance");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "solve_interval", PROPERTY_HINT_RANGE, "1,16,1,or_greater"), "set_solve_interval", "get_solve_interval");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "default_damp", PROPERTY_HINT_RANGE, "0.01,180.0,0.01,radians,exp", PROPERTY_USAGE_DEFAULT | PROPERTY_USAGE_UPDATE_ALL_IF_MODIFIED), "set_default_damp", "get_default_damp");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "initial_damp", PROPERTY_HINT_RANGE, "0,180.0,0.01,radians"), "set_initial_damp", "get_initial_damp");
 }
 
 EWBIK::EWBIK() {
 }
 
 EWBIK::~EWBIK() {
+	_cancel_rig_compilation();
 }
 
 void EWBIK::set_debug_skeleton(bool p_skeleton_debug) {
@@ -462,11 +882,55 @@ float EWBIK::get_pin_depth_falloff(int32_t p_effector_index) const {
 }
 
 void EWBIK::set_pin_depth_falloff(int32_t p_effector_index, const float p_depth_falloff) {
+	ERR_FAIL_INDEX(p_effector_index, pins.size());
 	Ref<IKEffectorTemplate> data = pins[p_effector_index];
 	ERR_FAIL_NULL(data);
 	data->set_depth_falloff(p_depth_falloff);
-	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	update_pin_weights(p_effector_index);
+}
+
+Ref<IKEffector3D> EWBIK::find_pin_effector(int32_t p_pin_index) {
+	ERR_FAIL_INDEX_V(p_pin_index, pins.size(), Ref<IKEffector3D>());
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton || segmented_skeleton.is_null() || pins[p_pin_index].is_null()) {
+		return Ref<IKEffector3D>();
+	}
+	BoneId bone_id = skeleton->find_bone(pins[p_pin_index]->get_name());
+	if (bone_id == -1) {
+		return Ref<IKEffector3D>();
+	}
+	Ref<IKBone3D> bone = segmented_skeleton->get_ik_bone(bone_id);
+	if (bone.is_null()) {
+		return Ref<IKEffector3D>();
+	}
+	return bone->get_pin();
+}
+
+void EWBIK::update_pin_weights(int32_t p_pin_index) {
+	if (is_dirty) {
+		return;
+	}
+	if (is_rebuilding()) {
+		// The rig in flight was compiled from the old settings.
+		_make_dirty();
+	}
+	Ref<IKEffector3D> effector = find_pin_effector(p_pin_index);
+	if (effector.is_null()) {
+		_make_dirty();
+		return;
+	}
+	const Ref<IKEffectorTemplate> data = pins[p_pin_index];
+	const int32_t old_heading_count = effector->get_heading_count();
+	const bool old_is_falling_off = effector->get_depth_falloff() > 0.0;
+	effector->set_weight(data->get_weight());
+	effector->set_depth_falloff(data->get_depth_falloff());
+	effector->set_direction_priorities(data->get_direction_priorities());
+	// A different number of headings, or a falloff toggling descendant pins on or off, changes the heading layout.
+	if (old_heading_count != effector->get_heading_count() || old_is_falling_off != (effector->get_depth_falloff() > 0.0)) {
+		_make_dirty();
+		return;
+	}
+	IKBoneSegment::recursive_update_heading_weights_for(segmented_skeleton);
 }
 
 void EWBIK::set_constraint_count(int32_t p_count) {
@@ -485,7 +949,7 @@ void EWBIK::set_constraint_count(int32_t p_count) {
 	}
 
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 int32_t EWBIK::get_constraint_count() const {
@@ -500,7 +964,36 @@ inline StringName EWBIK::get_constraint_name(int32_t p_index) const {
 void EWBIK::set_kusudama_twist(int32_t p_index, Vector2 p_to) {
 	ERR_FAIL_INDEX(p_index, constraint_count);
 	kusudama_twist.write[p_index] = p_to;
-	skeleton_changed(get_skeleton());
+	update_kusudama(p_index);
+}
+
+Ref<IKBone3D> EWBIK::find_constraint_bone(int32_t p_constraint_index) {
+	ERR_FAIL_INDEX_V(p_constraint_index, constraint_names.size(), Ref<IKBone3D>());
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton || segmented_skeleton.is_null()) {
+		return Ref<IKBone3D>();
+	}
+	BoneId bone_id = skeleton->find_bone(constraint_names[p_constraint_index]);
+	if (bone_id == -1) {
+		return Ref<IKBone3D>();
+	}
+	return segmented_skeleton->get_ik_bone(bone_id);
+}
+
+void EWBIK::update_kusudama(int32_t p_constraint_index) {
+	ERR_FAIL_INDEX(p_constraint_index, kusudama_limit_cones.size());
+	if (is_dirty) {
+		return;
+	}
+	if (is_rebuilding()) {
+		_make_dirty();
+	}
+	Ref<IKBone3D> bone = find_constraint_bone(p_constraint_index);
+	if (bone.is_null() || bone->get_constraint().is_null()) {
+		_make_dirty();
+		return;
+	}
+	IKCompiledRig::patch_constraint(get_skeleton(), bone, kusudama_limit_cones[p_constraint_index], get_kusudama_twist(p_constraint_index));
 }
 
 int32_t EWBIK::find_effector_id(StringName p_bone_name) {
@@ -524,7 +1017,7 @@ void EWBIK::set_kusudama_limit_cone(int32_t p_contraint_index, int32_t p_index,
 	cone.w = p_radius;
 	cones.write[p_index] = cone;
 	kusudama_limit_cones.write[p_contraint_index] = cones;
-	skeleton_changed(get_skeleton());
+	update_kusudama(p_contraint_index);
 }
 
 Vector3 EWBIK::get_kusudama_limit_cone_center(int32_t p_contraint_index, int32_t p_index) const {
@@ -566,17 +1059,25 @@ void EWBIK::set_kusudama_limit_cone_count(int32_t p_contraint_index, int32_t p_c
 	}
 
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	update_kusudama(p_contraint_index);
 }
 
 real_t EWBIK::get_default_damp() const {
 	return default_damp;
 }
 
+real_t EWBIK::get_initial_damp() const {
+	return initial_damp;
+}
+
+void EWBIK::set_initial_damp(real_t p_initial_damp) {
+	ERR_FAIL_COND(p_initial_damp < 0.0);
+	initial_damp = p_initial_damp;
+}
+
 void EWBIK::set_default_damp(float p_default_damp) {
 	default_damp = p_default_damp;
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
 }
 
 StringName EWBIK::get_pin_bone_name(int32_t p_effector_index) const {
@@ -591,7 +1092,7 @@ void EWBIK::set_kusudama_limit_cone_radius(int32_t p_effector_index, int32_t p_i
 	ERR_FAIL_INDEX(p_index, kusudama_limit_cones[p_effector_index].size());
 	Vector4 &cone = kusudama_limit_cones.write[p_effector_index].write[p_index];
 	cone.w = p_radius;
-	skeleton_changed(get_skeleton());
+	update_kusudama(p_effector_index);
 }
 
 void EWBIK::set_kusudama_limit_cone_center(int32_t p_effector_index, int32_t p_index, Vector3 p_center) {
@@ -602,7 +1103,7 @@ void EWBIK::set_kusudama_limit_cone_center(int32_t p_effector_index, int32_t p_i
 	cone.x = p_center.x;
 	cone.y = p_center.y;
 	cone.z = p_center.z;
-	skeleton_changed(get_skeleton());
+	update_kusudama(p_effector_index);
 }
 
 Vector2 EWBIK::get_kusudama_twist(int32_t p_index) const {
@@ -614,12 +1115,34 @@ void EWBIK::set_constraint_name(int32_t p_index, String p_name) {
 	ERR_FAIL_INDEX(p_index, constraint_names.size());
 	constraint_names.write[p_index] = p_name;
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 Ref<IKBoneSegment> EWBIK::get_segmented_skeleton() {
 	return segmented_skeleton;
 }
+
+Ref<IKCompiledRig> EWBIK::get_compiled_rig() const {
+	Skeleton3D *skeleton = get_skeleton();
+	if (compiled_rig.is_null() || !skeleton) {
+		return compiled_rig;
+	}
+	if (compiled_rig->matches(skeleton, root_bone, constraint_names, kusudama_twist, kusudama_flip_handedness, kusudama_limit_cones)) {
+		return compiled_rig;
+	}
+	// The constraints were patched in place since the rig was built, so compile what they are now.
+	return IKCompiledRig::find_or_compile(skeleton, root_bone, constraint_names, kusudama_twist, kusudama_flip_handedness, kusudama_limit_cones);
+}
+
+void EWBIK::set_baked_rig(const Ref<IKCompiledRig> &p_baked_rig) {
+	baked_rig = p_baked_rig;
+	_make_dirty();
+}
+
+Ref<IKCompiledRig> EWBIK::get_baked_rig() const {
+	return baked_rig;
+}
+
 float EWBIK::get_max_ik_iterations() const {
 	return max_ik_iterations;
 }
@@ -636,37 +1159,113 @@ bool EWBIK::get_kusudama_flip_handedness(int32_t p_bone) const {
 void EWBIK::set_kusudama_flip_handedness(int32_t p_bone, bool p_flip) {
 	ERR_FAIL_INDEX(p_bone, kusudama_flip_handedness.size());
 	kusudama_flip_handedness.write[p_bone] = p_flip;
-	if (segmented_skeleton.is_null()) {
+	if (is_dirty) {
 		return;
 	}
-	Ref<IKBone3D> bone = segmented_skeleton->get_ik_bone(p_bone);
-	if (bone.is_null()) {
-		return;
-	}
-	Ref<IKTransform3D> constraint_transform = bone->get_constraint_transform();
-	if (constraint_transform.is_null()) {
-		return;
+	if (is_rebuilding()) {
+		_make_dirty();
 	}
-	constraint_transform->set_global_chirality(p_flip ? -1.0 : 1.0);
-	Ref<IKTransform3D> transform = bone->get_ik_transform();
-	if (transform.is_null()) {
+	// Applied in place the same way a rebuild applies it.
+	Ref<IKBone3D> bone = find_constraint_bone(p_bone);
+	if (bone.is_null()) {
 		return;
 	}
-	transform->set_global_chirality(p_flip ? -1.0 : 1.0);
-	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	bone->set_flip_handedness(p_flip);
 }
 
-void EWBIK::set_pin_bone_name(int32_t p_effector_index, StringName p_name) const {
+void EWBIK::set_pin_bone_name(int32_t p_effector_index, StringName p_name) {
 	ERR_FAIL_INDEX(p_effector_index, pins.size());
 	Ref<IKEffectorTemplate> data = pins[p_effector_index];
 	data->set_name(p_name);
+	_make_dirty();
 }
 
 void EWBIK::set_pin_nodepath(int32_t p_effector_index, NodePath p_node_path) {
 	ERR_FAIL_INDEX(p_effector_index, pins.size());
 	Ref<IKEffectorTemplate> data = pins[p_effector_index];
 	data->set_target_node(p_node_path);
+	update_pin_target(p_effector_index);
+}
+
+void EWBIK::update_pin_target(int32_t p_pin_index) {
+	if (is_dirty) {
+		return;
+	}
+	if (is_rebuilding()) {
+		// The rig in flight was compiled from the old settings.
+		_make_dirty();
+	}
+	Ref<IKEffector3D> effector = find_pin_effector(p_pin_index);
+	if (effector.is_null()) {
+		_make_dirty();
+		return;
+	}
+	effector->set_target_node(get_skeleton(), pins[p_pin_index]->get_target_node());
+}
+
+void EWBIK::_make_dirty() {
+	is_dirty = true;
+}
+
+void EWBIK::rebuild() {
+	is_dirty = false;
+	skeleton_changed(get_skeleton());
+}
+
+void EWBIK::configure_from_dictionary(const Dictionary &p_configuration) {
+	if (p_configuration.has("root_bone")) {
+		set_root_bone(p_configuration["root_bone"]);
+	}
+	if (p_configuration.has("tip_bone")) {
+		set_tip_bone(p_configuration["tip_bone"]);
+	}
+	if (p_configuration.has("max_ik_iterations")) {
+		set_max_ik_iterations(p_configuration["max_ik_iterations"]);
+	}
+	if (p_configuration.has("default_damp")) {
+		set_default_damp(p_configuration["default_damp"]);
+	}
+	if (p_configuration.has("initial_damp")) {
+		set_initial_damp(p_configuration["initial_damp"]);
+	}
+	if (p_configuration.has("pins")) {
+		Array pin_array = p_configuration["pins"];
+		// Replaced rather than merged, so keys a pin leaves out take their defaults.
+		set_pin_count(0);
+		set_pin_count(pin_array.size());
+		for (int32_t pin_i = 0; pin_i < pin_array.size(); pin_i++) {
+			Dictionary pin = pin_array[pin_i];
+			const Ref<IKEffectorTemplate> data = pins[pin_i];
+			set_pin_bone(pin_i, pin.get("name", String()));
+			set_pin_target_nodepath(pin_i, pin.get("target_node", NodePath()));
+			set_pin_depth_falloff(pin_i, pin.get("depth_falloff", data->get_depth_falloff()));
+			set_pin_weight(pin_i, pin.get("weight", data->get_weight()));
+			set_pin_direction_priorities(pin_i, pin.get("direction_priorities", data->get_direction_priorities()));
+		}
+	}
+	if (p_configuration.has("constraints")) {
+		Array constraint_array = p_configuration["constraints"];
+		set_constraint_count(0);
+		set_constraint_count(constraint_array.size());
+		for (int32_t constraint_i = 0; constraint_i < constraint_array.size(); constraint_i++) {
+			Dictionary constraint = constraint_array[constraint_i];
+			set_constraint_name(constraint_i, constraint.get("name", String()));
+			set_kusudama_twist(constraint_i, constraint.get("kusudama_twist", Vector2()));
+			set_kusudama_flip_handedness(constraint_i, constraint.get("kusudama_flip_handedness", false));
+			Array cone_array = constraint.get("kusudama_limit_cones", Array());
+			set_kusudama_limit_cone_count(constraint_i, cone_array.size());
+			for (int32_t cone_i = 0; cone_i < cone_array.size(); cone_i++) {
+				Dictionary cone = cone_array[cone_i];
+				Vector3 center = cone.get("center", Vector3(0.0, 1.0, 0.0));
+				if (Math::is_zero_approx(center.length_squared())) {
+					center = Vector3(0.0, 1.0, 0.0);
+				}
+				set_kusudama_limit_cone(constraint_i, cone_i, center, cone.get("radius", Math::deg_to_rad(10.0f)));
+			}
+		}
+	}
+	notify_property_list_changed();
+	_make_dirty();
 }
 
 NodePath EWBIK::get_pin_nodepath(int32_t p_effector_index) const {
@@ -676,81 +1275,369 @@ NodePath EWBIK::get_pin_nodepath(int32_t p_effector_index) const {
 }
 
 void EWBIK::execute(real_t delta) {
-	if (segmented_skeleton.is_null()) {
+	Skeleton3D *skeleton = get_skeleton();
+	if (segmented_skeleton.is_null() || !skeleton) {
+		IKSolverCounters early_exit;
+		early_exit.early_exits = 1;
+		_add_solver_counters(early_exit);
+		last_solve_iterations = 0;
 		return;
 	}
 	if (bone_list.size()) {
-		Ref<IKTransform3D> root_ik_bone = bone_list.write[0]->get_ik_transform();
-		ERR_FAIL_NULL(root_ik_bone);
-		Ref<IKTransform3D> root_ik_parent_transform = root_ik_bone->get_parent();
-		ERR_FAIL_NULL(root_ik_parent_transform);
-		root_ik_parent_transform->set_global_transform(get_skeleton()->get_global_transform());
+		ERR_FAIL_NULL(root_transform);
+		root_transform->set_global_transform(skeleton->get_global_transform());
+	}
+	const uint64_t execute_start_usec = OS::get_singleton()->get_ticks_usec();
+	const uint64_t frame = Engine::get_singleton()->get_process_frames();
+	const bool budgeted = IKIterationBudget::is_enabled();
+	int32_t iterations = get_max_ik_iterations();
+	if (budgeted) {
+		// Asked on skipped frames too, so the rig keeps its share. The budget then counts it as solving every frame.
+		iterations = IKIterationBudget::get_iterations(get_instance_id(), iterations, frame);
+	}
+	if (iterations_per_frame > 0) {
+		iterations = MIN(iterations, iterations_per_frame);
 	}
-	update_shadow_bones_transform();
-	for (int32_t i = 0; i < get_max_ik_iterations(); i++) {
-		segmented_skeleton->segment_solver(get_default_damp());
+	IK_PERFORMANCE_SOLVE();
+	if (!IKSolveScheduler::is_due(get_instance_id(), solve_interval, uint64_t(bone_list.size()) * iterations, frame)) {
+		// Keep the last solved pose on the skeleton in case an animation overwrote it.
+		IK_PERFORMANCE_STAGE(STAGE_WRITE_BACK);
+		update_skeleton_bones_transform(skeleton);
+		last_solve_iterations = 0;
+		return;
+	}
+	uint64_t solve_usec = 0;
+	{
+		IK_PERFORMANCE_STAGE(STAGE_GATHER);
+		if (iterations_per_frame > 0 && amortized_pose_valid) {
+			// Keep converging from where the last frame stopped instead of the skeleton's pose.
+			_update_pin_targets(skeleton);
+		} else {
+			update_shadow_bones_transform(skeleton);
+			amortized_pose_valid = iterations_per_frame > 0;
+			amortized_iterations = 0;
+		}
+	}
+	// An amortized solve spreads a single schedule of max_ik_iterations over the frames it takes.
+	const int32_t schedule_start = iterations_per_frame > 0 ? amortized_iterations : 0;
+	const int32_t schedule_iterations = iterations_per_frame > 0 ? get_max_ik_iterations() : iterations;
+	if (recording.is_open()) {
+		IKTargetRecording::FrameSolve frame_solve;
+		frame_solve.iterations = iterations;
+		frame_solve.schedule_start = schedule_start;
+		frame_solve.schedule_iterations = schedule_iterations;
+		_record_frame(delta, frame_solve, skeleton->get_global_transform());
 	}
-	update_skeleton_bones_transform();
+	{
+		IK_PERFORMANCE_STAGE(STAGE_SOLVE);
+		IKSolverCounters solve_counters;
+		solve_counters.solves = 1;
+		IKSolverCounters::current = &solve_counters;
+		const uint64_t solve_start_usec = OS::get_singleton()->get_ticks_usec();
+		float *convergence_rows = _begin_convergence_solve();
+		int32_t solved_iterations = 0;
+		bool converged = false;
+		while (solved_iterations < iterations) {
+			const real_t damp = IKBoneSegment::get_scheduled_damp(initial_damp, get_default_damp(), schedule_start + solved_iterations, schedule_iterations);
+			const bool solved = segmented_skeleton->segment_solver(damp, segment_tolerance);
+			if (convergence_rows) {
+				_sample_convergence(convergence_rows + solved_iterations * convergence_pin_count);
+			}
+			solved_iterations++;
+			if (!solved) {
+				// Every segment is within tolerance, the rest of the iterations would not move anything.
+				converged = true;
+				break;
+			}
+		}
+		iterations = solved_iterations;
+		if (iterations_per_frame > 0) {
+			amortized_iterations += iterations;
+			if (converged || amortized_iterations >= schedule_iterations) {
+				// The solve is done, so the next one starts from the skeleton's pose again and picks up its animation.
+				amortized_pose_valid = false;
+				amortized_iterations = 0;
+			}
+		}
+		if (convergence_rows) {
+			// Iterations the budget or the tolerance skipped keep the error the solve stopped at.
+			for (int32_t i = MAX(iterations, 1); i < convergence_iteration_count; i++) {
+				memcpy(convergence_rows + i * convergence_pin_count, convergence_rows + (i - 1) * convergence_pin_count, convergence_pin_count * sizeof(float));
+			}
+			_end_convergence_solve();
+		}
+		solve_usec = OS::get_singleton()->get_ticks_usec() - solve_start_usec;
+		IKSolverCounters::current = nullptr;
+		_add_solver_counters(solve_counters);
+		IK_PERFORMANCE_ADD_ITERATIONS(iterations);
+	}
+	{
+		IK_PERFORMANCE_STAGE(STAGE_WRITE_BACK);
+		update_skeleton_bones_transform(skeleton);
+	}
+	last_solve_iterations = iterations;
+	if (budgeted) {
+		real_t error = 0.0;
+		for (const Ref<IKEffector3D> &effector : pin_effectors) {
+			if (effector.is_valid()) {
+				error += effector->get_weighted_error();
+			}
+		}
+		const uint64_t execute_usec = OS::get_singleton()->get_ticks_usec() - execute_start_usec;
+		IKIterationBudget::report(get_instance_id(), iterations, solve_usec, execute_usec - MIN(solve_usec, execute_usec), error);
+	}
+}
+
+void EWBIK::set_iteration_budget_msec(float p_msec) {
+	IKIterationBudget::set_budget_usec(uint64_t(MAX(p_msec, 0.0f) * 1000.0f));
+}
+
+float EWBIK::get_iteration_budget_msec() {
+	return IKIterationBudget::get_budget_usec() / 1000.0f;
+}
+
+int32_t EWBIK::get_last_solve_iterations() const {
+	return last_solve_iterations;
+}
+
+void EWBIK::set_iterations_per_frame(int32_t p_iterations) {
+	ERR_FAIL_COND(p_iterations < 0);
+	iterations_per_frame = p_iterations;
+	amortized_pose_valid = false;
+}
+
+int32_t EWBIK::get_iterations_per_frame() const {
+	return iterations_per_frame;
+}
+
+void EWBIK::restart_amortized_solve() {
+	amortized_pose_valid = false;
+}
+
+void EWBIK::set_segment_tolerance(real_t p_tolerance) {
+	ERR_FAIL_COND(p_tolerance < 0.0);
+	segment_tolerance = p_tolerance;
+}
+
+real_t EWBIK::get_segment_tolerance() const {
+	return segment_tolerance;
+}
+
+void EWBIK::set_solve_interval(int32_t p_interval) {
+	ERR_FAIL_COND(p_interval < 1);
+	solve_interval = p_interval;
+}
+
+int32_t EWBIK::get_solve_interval() const {
+	return solve_interval;
 }
 
 void EWBIK::skeleton_changed(Skeleton3D *p_skeleton) {
-	if (!p_skeleton) {
+	IK_PROFILE_ZONE("skeleton_changed");
+	_cancel_rig_compilation();
+	// Built from the current settings, so it stands in for the job that was cancelled.
+	is_dirty = false;
+	RigCompileJob job;
+	if (!_prepare_rig_compile_job(p_skeleton, &job, false)) {
 		return;
 	}
+	_compile_rig(&job);
+	_apply_compiled_rig(&job);
+}
+
+bool EWBIK::_prepare_rig_compile_job(Skeleton3D *p_skeleton, RigCompileJob *r_job, bool p_snapshot) {
+	if (!p_skeleton) {
+		return false;
+	}
 	if (!root_bone) {
 		Vector<int32_t> roots = p_skeleton->get_parentless_bones();
 		if (roots.size()) {
-			StringName parentless_bone = p_skeleton->get_bone_name(roots[0]);
-			set_root_bone(parentless_bone);
-		}
-	}
-	ERR_FAIL_COND(!root_bone);
-	BoneId root_bone_index = p_skeleton->find_bone(root_bone);
-	BoneId tip_bone_index = p_skeleton->find_bone(tip_bone);
-	segmented_skeleton = Ref<IKBoneSegment>(memnew(IKBoneSegment(p_skeleton, root_bone, pins, nullptr, root_bone_index, tip_bone_index)));
-	segmented_skeleton->get_root()->get_ik_transform()->set_parent(root_transform);
-	segmented_skeleton->generate_default_segments_from_root(pins, root_bone_index, tip_bone_index);
-	bone_list.clear();
-	segmented_skeleton->create_bone_list(bone_list, true, debug_skeleton);
+			root_bone = p_skeleton->get_bone_name(roots[0]);
+			notify_property_list_changed();
+		}
+	}
+	ERR_FAIL_COND_V(!root_bone, false);
+	r_job->skeleton = p_snapshot ? _snapshot_skeleton(p_skeleton) : p_skeleton;
+	r_job->owns_skeleton = p_snapshot;
+	r_job->skeleton_id = p_skeleton->get_instance_id();
+	r_job->root_bone = root_bone;
+	r_job->tip_bone = tip_bone;
+	r_job->pins.resize(pins.size());
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		const Ref<IKEffectorTemplate> &pin = pins[pin_i];
+		if (pin.is_null()) {
+			continue;
+		}
+		Ref<IKEffectorTemplate> data;
+		data.instantiate();
+		data->set_name(pin->get_name());
+		data->set_target_node(pin->get_target_node());
+		data->set_depth_falloff(pin->get_depth_falloff());
+		data->set_weight(pin->get_weight());
+		data->set_direction_priorities(pin->get_direction_priorities());
+		r_job->pins.write[pin_i] = data;
+	}
+	r_job->constraint_names = constraint_names;
+	r_job->kusudama_twist = kusudama_twist;
+	r_job->kusudama_flip_handedness = kusudama_flip_handedness;
+	r_job->kusudama_limit_cones = kusudama_limit_cones;
+	r_job->debug_skeleton = debug_skeleton;
+	r_job->baked_rig = baked_rig;
+	const Transform3D skeleton_transform = p_skeleton->get_transform();
+	r_job->bone_global_poses.resize(p_skeleton->get_bone_count());
+	for (int32_t bone_i = 0; bone_i < r_job->bone_global_poses.size(); bone_i++) {
+		r_job->bone_global_poses.write[bone_i] = skeleton_transform * p_skeleton->get_bone_global_pose(bone_i);
+	}
+	return true;
+}
+
+Skeleton3D *EWBIK::_snapshot_skeleton(const Skeleton3D *p_skeleton) {
+	Skeleton3D *snapshot = memnew(Skeleton3D);
+	const int32_t bone_count = p_skeleton->get_bone_count();
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		snapshot->add_bone(p_skeleton->get_bone_name(bone_i));
+	}
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		snapshot->set_bone_parent(bone_i, p_skeleton->get_bone_parent(bone_i));
+		snapshot->set_bone_rest(bone_i, p_skeleton->get_bone_rest(bone_i));
+		snapshot->set_bone_pose_position(bone_i, p_skeleton->get_bone_pose_position(bone_i));
+		snapshot->set_bone_pose_rotation(bone_i, p_skeleton->get_bone_pose_rotation(bone_i));
+		snapshot->set_bone_pose_scale(bone_i, p_skeleton->get_bone_pose_scale(bone_i));
+	}
+	snapshot->set_transform(p_skeleton->get_transform());
+	return snapshot;
+}
+
+void EWBIK::_compile_rig(RigCompileJob *r_job) {
+	IK_PROFILE_ZONE("compile_rig");
+	Skeleton3D *skeleton = r_job->skeleton;
+	BoneId root_bone_index = skeleton->find_bone(r_job->root_bone);
+	BoneId tip_bone_index = skeleton->find_bone(r_job->tip_bone);
+	r_job->root_transform.instantiate();
+	Ref<IKBoneSegment> segmented_skeleton = Ref<IKBoneSegment>(memnew(IKBoneSegment(skeleton, r_job->root_bone, r_job->pins, nullptr, root_bone_index, tip_bone_index)));
+	segmented_skeleton->get_root()->get_ik_transform()->set_parent(r_job->root_transform);
+	segmented_skeleton->generate_default_segments_from_root(r_job->pins, root_bone_index, tip_bone_index);
+	Vector<Ref<IKBone3D>> &bone_list = r_job->bone_list;
+	// Printed once the rig is applied, on the main thread.
+	segmented_skeleton->create_bone_list(bone_list, true, false);
+	segmented_skeleton->prune_unsolved_bones(bone_list);
 	Vector<Vector<real_t>> weight_array;
 	segmented_skeleton->update_pinned_list(weight_array);
 	segmented_skeleton->recursive_create_headings_arrays_for(segmented_skeleton);
-	update_shadow_bones_transform();
-	for (int constraint_i = 0; constraint_i < constraint_count; constraint_i++) {
-		String bone = constraint_names[constraint_i];
-		BoneId bone_id = p_skeleton->find_bone(bone);
+	// Parents come last in the bone list, so walk it backwards to pose them first.
+	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+		Ref<IKBone3D> bone = bone_list[bone_i];
+		if (bone.is_null() || bone->get_bone_id() == -1 || bone->get_bone_id() >= r_job->bone_global_poses.size()) {
+			continue;
+		}
+		bone->set_global_pose(r_job->bone_global_poses[bone->get_bone_id()]);
+	}
+	if (r_job->baked_rig.is_valid()) {
+		if (r_job->baked_rig->matches(skeleton, r_job->root_bone, r_job->constraint_names, r_job->kusudama_twist, r_job->kusudama_flip_handedness, r_job->kusudama_limit_cones)) {
+			r_job->compiled_rig = r_job->baked_rig;
+		} else {
+			WARN_PRINT("The baked IK rig doesn't match the skeleton or the constraints anymore, compiling it instead. Bake it again to speed up loading.");
+		}
+	}
+	if (r_job->compiled_rig.is_null()) {
+		r_job->compiled_rig = IKCompiledRig::find_or_compile(skeleton, r_job->root_bone, r_job->constraint_names, r_job->kusudama_twist, r_job->kusudama_flip_handedness, r_job->kusudama_limit_cones);
+	}
+	ERR_FAIL_NULL(r_job->compiled_rig);
+	for (const IKCompiledRig::Constraint &compiled_constraint : r_job->compiled_rig->get_constraints()) {
+		if (compiled_constraint.bone_id == -1) {
+			continue;
+		}
 		for (Ref<IKBone3D> ik_bone_3d : bone_list) {
-			if (ik_bone_3d->get_bone_id() != bone_id) {
+			if (ik_bone_3d->get_bone_id() != compiled_constraint.bone_id) {
 				continue;
 			}
-			Ref<IKTransform3D> bone_direction_transform;
-			bone_direction_transform.instantiate();
-			bone_direction_transform->set_parent(ik_bone_3d->get_ik_transform());
-			bone_direction_transform->set_transform(Transform3D(Basis(), ik_bone_3d->get_bone_direction_transform()->get_transform().origin));
-			Ref<IKKusudama> constraint = memnew(IKKusudama(ik_bone_3d));
-			constraint->enable_axial_limits();
-			const Vector2 axial_limit = get_kusudama_twist(constraint_i);
-			for (int32_t cone_i = 0; cone_i < kusudama_limit_cone_count[constraint_i]; cone_i++) {
-				if (cone_i == 0) {
-					constraint->enable_orientational_limits();
-				}
-				Vector4 cone = kusudama_limit_cones[constraint_i][cone_i];
-				constraint->add_limit_cone(Vector3(cone.x, cone.y, cone.z), cone.w);
-			}
-			constraint->_update_constraint();
-			constraint->set_axial_limits(axial_limit.x, axial_limit.y);
-			ik_bone_3d->add_constraint(constraint);
+			IKCompiledRig::attach_constraint(compiled_constraint, ik_bone_3d);
 			break;
 		}
 	}
-	for (Ref<IKBone3D> ik_bone_3d : bone_list) {
-		Ref<IKKusudama> constraint = ik_bone_3d->get_constraint();
-		if (constraint.is_null()) {
-			continue;
+	// Only read while compiling. A snapshot goes away with the job.
+	segmented_skeleton->clear_skeleton();
+	r_job->segmented_skeleton = segmented_skeleton;
+}
+
+void EWBIK::_compile_rig_task(void *p_userdata) {
+	_compile_rig(static_cast<RigCompileJob *>(p_userdata));
+}
+
+void EWBIK::_apply_compiled_rig(RigCompileJob *p_job) {
+	if (p_job->segmented_skeleton.is_null()) {
+		return;
+	}
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton || skeleton->get_instance_id() != p_job->skeleton_id) {
+		// Built for a skeleton that has since been replaced.
+		_make_dirty();
+		return;
+	}
+	if (p_job->debug_skeleton) {
+		Vector<Ref<IKBone3D>> debug_bone_list;
+		p_job->segmented_skeleton->create_bone_list(debug_bone_list, true, true);
+	}
+	segmented_skeleton = p_job->segmented_skeleton;
+	compiled_rig = p_job->compiled_rig;
+	amortized_pose_valid = false;
+	IKSolverCounters rebuild;
+	rebuild.rebuilds = 1;
+	_add_solver_counters(rebuild);
+	bone_list = p_job->bone_list;
+	root_transform = p_job->root_transform;
+	pin_effectors.resize(pins.size());
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		pin_effectors.write[pin_i] = find_pin_effector(pin_i);
+		if (pin_effectors[pin_i].is_valid() && pin_i < pin_target_overrides.size()) {
+			pin_effectors[pin_i]->set_target_override(pin_target_overrides[pin_i], pin_target_override_transforms[pin_i]);
 		}
-		constraint->update_tangent_radii();
-		constraint->update_rotational_freedom();
 	}
+	update_shadow_bones_transform(skeleton);
+}
+
+void EWBIK::_start_rig_compilation() {
+	is_dirty = false;
+	// The editor can change the skeleton's topology at any time, so it compiles in place.
+	if (!threaded_rebuild || Engine::get_singleton()->is_editor_hint()) {
+		skeleton_changed(get_skeleton());
+		return;
+	}
+	ERR_FAIL_COND(rig_compile_job);
+	RigCompileJob *job = memnew(RigCompileJob);
+	if (!_prepare_rig_compile_job(get_skeleton(), job, true)) {
+		memdelete(job);
+		return;
+	}
+	rig_compile_job = job;
+	rig_compile_task = WorkerThreadPool::get_singleton()->add_native_task(&EWBIK::_compile_rig_task, job, false, "EWBIK rig compilation");
+}
+
+bool EWBIK::_poll_rig_compilation() {
+	if (rig_compile_task == WorkerThreadPool::INVALID_TASK_ID) {
+		return false;
+	}
+	if (!WorkerThreadPool::get_singleton()->is_task_completed(rig_compile_task)) {
+		return true;
+	}
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(rig_compile_task);
+	rig_compile_task = WorkerThreadPool::INVALID_TASK_ID;
+	_apply_compiled_rig(rig_compile_job);
+	memdelete(rig_compile_job);
+	rig_compile_job = nullptr;
+	return false;
+}
+
+void EWBIK::_cancel_rig_compilation() {
+	if (rig_compile_task == WorkerThreadPool::INVALID_TASK_ID) {
+		return;
+	}
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(rig_compile_task);
+	rig_compile_task = WorkerThreadPool::INVALID_TASK_ID;
+	memdelete(rig_compile_job);
+	rig_compile_job = nullptr;
+	// The settings it was compiled from haven't been applied yet.
+	_make_dirty();
 }
 
 StringName EWBIK::get_root_bone() const {
@@ -760,7 +1647,7 @@ StringName EWBIK::get_root_bone() const {
 void EWBIK::set_root_bone(const StringName &p_root_bone) {
 	root_bone = p_root_bone;
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
 
 StringName EWBIK::get_tip_bone() const {
@@ -770,5 +1657,5 @@ StringName EWBIK::get_tip_bone() const {
 void EWBIK::set_tip_bone(StringName p_bone) {
 	tip_bone = p_bone;
 	notify_property_list_changed();
-	skeleton_changed(get_skeleton());
+	_make_dirty();
 }
@@ -31,19 +31,60 @@
 #ifndef SKELETON_MODIFICATION_3D_EWBIK_H
 #define SKELETON_MODIFICATION_3D_EWBIK_H
 
+#include "core/object/callable_method_pointer.h"
 #include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
 #include "core/os/memory.h"
+#include "scene/main/scene_tree.h"
 #include "ik_bone_3d.h"
+#include "ik_compiled_rig.h"
 #include "ik_effector_template.h"
+#include "ik_iteration_budget.h"
+#include "ik_solve_scheduler.h"
+#include "ik_solver_counters.h"
+#include "ik_target_recording.h"
+#include "ik_target_stream.h"
 #include "math/ik_transform.h"
 
 class IKBoneSegment;
 class EWBIK : public Node {
 	GDCLASS(EWBIK, Node);
+
+	// Everything a rig compilation reads, copied on the main thread so a worker can build the rig while the old one keeps solving.
+	struct RigCompileJob {
+		// The skeleton to compile from. Jobs sent to a worker own a detached copy of its bones, rests and poses, since the
+		// live skeleton can be posed, swapped or freed while they run.
+		Skeleton3D *skeleton = nullptr;
+		bool owns_skeleton = false;
+		ObjectID skeleton_id;
+		StringName root_bone;
+		StringName tip_bone;
+		Vector<Ref<IKEffectorTemplate>> pins;
+		Vector<StringName> constraint_names;
+		Vector<Vector2> kusudama_twist;
+		Vector<bool> kusudama_flip_handedness;
+		Vector<Vector<Vector4>> kusudama_limit_cones;
+		bool debug_skeleton = true;
+		Vector<Transform3D> bone_global_poses;
+		Ref<IKBoneSegment> segmented_skeleton;
+		Vector<Ref<IKBone3D>> bone_list;
+		Ref<IKTransform3D> root_transform;
+		Ref<IKCompiledRig> baked_rig;
+		Ref<IKCompiledRig> compiled_rig;
+
+		~RigCompileJob() {
+			if (owns_skeleton && skeleton) {
+				memdelete(skeleton);
+			}
+		}
+	};
+
 	StringName root_bone;
 	StringName tip_bone;
 	NodePath skeleton_path;
 	Ref<IKBoneSegment> segmented_skeleton;
+	Ref<IKCompiledRig> compiled_rig;
+	Ref<IKCompiledRig> baked_rig;
 	int32_t constraint_count = 0;
 	Vector<StringName> constraint_names;
 	int32_t pin_count = 0;
@@ -56,14 +97,71 @@ class EWBIK : public Node {
 	float MAX_KUSUDAMA_LIMIT_CONES = 30;
 	int32_t max_ik_iterations = 10;
 	float default_damp = Math::deg_to_rad(15.0f);
+	real_t initial_damp = 0.0;
 	bool debug_skeleton = true;
 	Ref<IKTransform3D> root_transform = memnew(IKTransform3D);
 	bool is_dirty = true;
 	bool is_enabled = true;
+	bool threaded_rebuild = true;
+	RigCompileJob *rig_compile_job = nullptr;
+	WorkerThreadPool::TaskID rig_compile_task = WorkerThreadPool::INVALID_TASK_ID;
 	NodePath skeleton_node_path = NodePath("..");
-	void update_shadow_bones_transform();
-	void update_skeleton_bones_transform();
+	Vector<Transform3D> input_pose_buffer;
+	bool target_node_caches_dirty = true;
+	Vector<Ref<IKEffector3D>> pin_effectors;
+	Vector<IKEffector3D::TargetOverride> pin_target_overrides;
+	Vector<Transform3D> pin_target_override_transforms;
+	Ref<IKTargetStream> target_stream;
+	Vector<Transform3D> stream_targets;
+	IKTargetRecording recording;
+	int32_t convergence_history_size = 0;
+	// A ring of convergence_history_size solves, each max_ik_iterations rows of one error per pin.
+	Vector<float> convergence_history;
+	int32_t convergence_iteration_count = 0;
+	int32_t convergence_pin_count = 0;
+	int32_t convergence_next_solve = 0;
+	int32_t convergence_solve_count = 0;
+	IKSolverCounters solver_counters;
+	int32_t last_solve_iterations = 0;
+	int32_t iterations_per_frame = 0;
+	// Whether the shadow skeleton holds a pose an amortized solve can keep converging from.
+	bool amortized_pose_valid = false;
+	// Iterations the current amortized solve has run, so its damp schedule carries on across frames.
+	int32_t amortized_iterations = 0;
+	int32_t solve_interval = 1;
+	real_t segment_tolerance = 0.0;
+	void _add_solver_counters(const IKSolverCounters &p_counters);
+	float *_begin_convergence_solve();
+	void _sample_convergence(float *r_row) const;
+	void _end_convergence_solve();
+	Vector<Transform3D> recording_poses;
+	Vector<Transform3D> recording_targets;
+	void _resize_pin_target_overrides();
+	void _set_pin_target_override(int32_t p_pin_index, IKEffector3D::TargetOverride p_override, const Transform3D &p_transform);
+	void _pull_target_stream();
+	void _on_tree_changed();
+	void update_shadow_bones_transform(Skeleton3D *p_skeleton);
+	void _update_pin_targets(Skeleton3D *p_skeleton);
+	void _write_shadow_bone_poses(const Transform3D *p_input_poses);
+	void _read_shadow_bone_poses(Transform3D *r_poses) const;
+	void _get_pinned_effectors(Vector<Ref<IKEffector3D>> &r_effectors) const;
+	void _record_frame(real_t p_delta, const IKTargetRecording::FrameSolve &p_solve, const Transform3D &p_root_parent);
+	void update_skeleton_bones_transform(Skeleton3D *p_skeleton);
 	Vector<Ref<IKEffectorTemplate>> get_bone_effectors() const;
+	Ref<IKBone3D> find_constraint_bone(int32_t p_constraint_index);
+	void update_kusudama(int32_t p_constraint_index);
+	Ref<IKEffector3D> find_pin_effector(int32_t p_pin_index);
+	void update_pin_weights(int32_t p_pin_index);
+	void update_pin_target(int32_t p_pin_index);
+	void _make_dirty();
+	bool _prepare_rig_compile_job(Skeleton3D *p_skeleton, RigCompileJob *r_job, bool p_snapshot);
+	static Skeleton3D *_snapshot_skeleton(const Skeleton3D *p_skeleton);
+	static void _compile_rig(RigCompileJob *r_job);
+	static void _compile_rig_task(void *p_userdata);
+	void _apply_compiled_rig(RigCompileJob *p_job);
+	void _start_rig_compilation();
+	bool _poll_rig_compilation();
+	void _cancel_rig_compilation();
 
 protected:
 	void _validate_property(PropertyInfo &property) const;
@@ -78,20 +176,35 @@ protected:
 			case NOTIFICATION_READY: {
 				set_process_internal(true);
 			} break;
+			case NOTIFICATION_ENTER_TREE: {
+				get_tree()->connect("tree_changed", callable_mp(this, &EWBIK::_on_tree_changed));
+				target_node_caches_dirty = true;
+			} break;
 			case NOTIFICATION_INTERNAL_PROCESS: {
 				if (!is_enabled) {
 					return;
 				}
-				if (is_dirty) {
-					skeleton_changed(get_skeleton());
-					is_dirty = false;
-				}
-				execute(get_process_delta_time());
+				update_ik(get_process_delta_time());
+			} break;
+			case NOTIFICATION_EXIT_TREE: {
+				_cancel_rig_compilation();
+				IKIterationBudget::remove(get_instance_id());
+				IKSolveScheduler::remove(get_instance_id());
+				get_tree()->disconnect("tree_changed", callable_mp(this, &EWBIK::_on_tree_changed));
 			} break;
 		}
 	}
 
 public:
+	void update_ik(real_t p_delta) {
+		if (!_poll_rig_compilation()) {
+			if (is_dirty) {
+				_start_rig_compilation();
+			}
+		}
+		_pull_target_stream();
+		execute(p_delta);
+	}
 	void set_enabled(bool p_enabled) {
 		is_enabled = p_enabled;
 	}
@@ -99,9 +212,20 @@ public:
 		return is_enabled;
 	}
 	void set_skeleton_node_path(NodePath p_skeleton_node_path) {
+		// A rig in flight was built for the old skeleton.
+		_cancel_rig_compilation();
 		is_dirty = true;
 		skeleton_node_path = p_skeleton_node_path;
 	}
+	void set_threaded_rebuild(bool p_threaded_rebuild) {
+		threaded_rebuild = p_threaded_rebuild;
+	}
+	bool get_threaded_rebuild() const {
+		return threaded_rebuild;
+	}
+	bool is_rebuilding() const {
+		return rig_compile_task != WorkerThreadPool::INVALID_TASK_ID;
+	}
 	NodePath get_skeleton_node_path() {
 		return skeleton_node_path;
 	}
@@ -114,6 +238,9 @@ public:
 	StringName get_tip_bone() const;
 	void set_tip_bone(StringName p_bone);
 	Ref<IKBoneSegment> get_segmented_skeleton();
+	Ref<IKCompiledRig> get_compiled_rig() const;
+	void set_baked_rig(const Ref<IKCompiledRig> &p_baked_rig);
+	Ref<IKCompiledRig> get_baked_rig() const;
 	float get_max_ik_iterations() const;
 	void set_max_ik_iterations(const float &p_max_ik_iterations);
 	float get_time_budget_millisecond() const;
@@ -125,7 +252,7 @@ public:
 	int32_t get_pin_count() const;
 	void set_pin_bone(int32_t p_pin_index, const String &p_bone);
 	StringName get_pin_bone_name(int32_t p_effector_index) const;
-	void set_pin_bone_name(int32_t p_effector_index, StringName p_name) const;
+	void set_pin_bone_name(int32_t p_effector_index, StringName p_name);
 	void set_pin_nodepath(int32_t p_effector_index, NodePath p_node_path);
 	NodePath get_pin_nodepath(int32_t p_effector_index) const;
 	int32_t find_effector_id(StringName p_bone_name);
@@ -138,8 +265,7 @@ public:
 			pins.write[p_pin_index] = data;
 		}
 		data->set_weight(p_weight);
-		notify_property_list_changed();
-		skeleton_changed(get_skeleton());
+		update_pin_weights(p_pin_index);
 	}
 	real_t get_pin_weight(int32_t p_pin_index) const {
 		ERR_FAIL_INDEX_V(p_pin_index, pins.size(), 0.0);
@@ -154,8 +280,7 @@ public:
 			pins.write[p_pin_index] = data;
 		}
 		data->set_direction_priorities(p_priority_direction);
-		notify_property_list_changed();
-		skeleton_changed(get_skeleton());
+		update_pin_weights(p_pin_index);
 	}
 	Vector3 get_pin_direction_priorities(int32_t p_pin_index) const {
 		ERR_FAIL_INDEX_V(p_pin_index, pins.size(), Vector3(0, 0, 0));
@@ -163,10 +288,44 @@ public:
 		return data->get_direction_priorities();
 	}
 	NodePath get_pin_target_nodepath(int32_t p_pin_index);
+	void set_pin_target_transforms(const PackedFloat32Array &p_transforms);
+	void set_pin_target_positions(const PackedVector3Array &p_positions);
+	void clear_pin_target_overrides();
+	void set_target_stream(const Ref<IKTargetStream> &p_target_stream);
+	Ref<IKTargetStream> get_target_stream() const;
+	Error start_recording(const String &p_path);
+	void stop_recording();
+	bool is_recording() const;
+	Dictionary replay_recording(const String &p_path, int32_t p_iterations = -1);
+	void set_convergence_history_size(int32_t p_size);
+	int32_t get_convergence_history_size() const;
+	int32_t get_convergence_solve_count() const;
+	PackedFloat32Array get_convergence_solve(int32_t p_index) const;
+	PackedFloat32Array get_convergence_curve() const;
+	void clear_convergence_history();
+	static Error start_profiler_trace(const String &p_path);
+	static void stop_profiler_trace();
+	Dictionary get_solver_stats() const;
+	void reset_solver_stats();
+	Dictionary get_memory_usage() const;
+	static void set_iteration_budget_msec(float p_msec);
+	static float get_iteration_budget_msec();
+	int32_t get_last_solve_iterations() const;
+	void set_iterations_per_frame(int32_t p_iterations);
+	int32_t get_iterations_per_frame() const;
+	void restart_amortized_solve();
+	void set_segment_tolerance(real_t p_tolerance);
+	real_t get_segment_tolerance() const;
+	void set_solve_interval(int32_t p_interval);
+	int32_t get_solve_interval() const;
+	static Dictionary get_global_solver_stats();
+	static void reset_global_solver_stats();
 	void set_pin_depth_falloff(int32_t p_effector_index, const float p_depth_falloff);
 	float get_pin_depth_falloff(int32_t p_effector_index) const;
 	real_t get_default_damp() const;
 	void set_default_damp(float p_default_damp);
+	real_t get_initial_damp() const;
+	void set_initial_damp(real_t p_initial_damp);
 	void set_constraint_count(int32_t p_count);
 	int32_t get_constraint_count() const;
 	StringName get_constraint_name(int32_t p_index) const;
@@ -183,6 +342,8 @@ public:
 	void set_kusudama_limit_cone_count(int32_t p_constraint_index, int32_t p_count);
 	bool get_kusudama_flip_handedness(int32_t p_bone) const;
 	void set_kusudama_flip_handedness(int32_t p_bone, bool p_flip);
+	void rebuild();
+	void configure_from_dictionary(const Dictionary &p_configuration);
 	EWBIK();
 	~EWBIK();
 };
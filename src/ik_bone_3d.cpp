@@ -93,17 +93,40 @@ void IKBone3D::set_initial_pose(Skeleton3D *p_skeleton) {
 	set_global_pose(xform);
 }
 
+void IKBone3D::set_pose_unpropagated(const Transform3D &p_transform) {
+	transform->local_transform = p_transform;
+	transform->dirty |= IKTransform3D::DIRTY_VECTORS | IKTransform3D::DIRTY_GLOBAL;
+	constraint_transform->local_transform.origin = p_transform.origin;
+	constraint_transform->dirty |= IKTransform3D::DIRTY_GLOBAL;
+}
+
 void IKBone3D::set_skeleton_bone_pose(Skeleton3D *p_skeleton, real_t p_strength) {
 	ERR_FAIL_NULL(p_skeleton);
-	Transform3D custom = get_global_pose();
-	custom = p_skeleton->get_global_transform().affine_inverse() * custom;
-	int32_t parent_id = p_skeleton->get_bone_parent(bone_id);
-	if (parent_id != -1) {
-		custom = p_skeleton->get_bone_global_pose(parent_id).affine_inverse() * custom;
+	Transform3D custom;
+	if (parent.is_valid()) {
+		// The shadow parent is also the skeleton parent, so the local pose carries over without reading a global pose back,
+		// which would make the skeleton recompute every bone after each write.
+		custom = get_pose();
+	} else {
+		custom = get_global_pose();
+		custom = p_skeleton->get_global_transform().affine_inverse() * custom;
+		int32_t parent_id = p_skeleton->get_bone_parent(bone_id);
+		if (parent_id != -1) {
+			custom = p_skeleton->get_bone_global_pose(parent_id).affine_inverse() * custom;
+		}
+	}
+	// Each write invalidates the skeleton's pose cache, so only components that moved are written.
+	if (!p_skeleton->get_bone_pose_position(bone_id).is_equal_approx(custom.origin)) {
+		p_skeleton->set_bone_pose_position(bone_id, custom.origin);
+	}
+	const Quaternion rotation = custom.basis.get_rotation_quaternion();
+	if (!p_skeleton->get_bone_pose_rotation(bone_id).is_equal_approx(rotation)) {
+		p_skeleton->set_bone_pose_rotation(bone_id, rotation);
+	}
+	const Vector3 scale = custom.basis.get_scale();
+	if (!p_skeleton->get_bone_pose_scale(bone_id).is_equal_approx(scale)) {
+		p_skeleton->set_bone_pose_scale(bone_id, scale);
 	}
-	p_skeleton->set_bone_pose_position(bone_id, custom.origin);
-	p_skeleton->set_bone_pose_rotation(bone_id, custom.basis.get_rotation_quaternion());
-	p_skeleton->set_bone_pose_scale(bone_id, custom.basis.get_scale());
 }
 
 void IKBone3D::create_pin() {
@@ -148,6 +171,36 @@ IKBone3D::IKBone3D(StringName p_bone, Skeleton3D *p_skeleton, const Ref<IKBone3D
 	bone_direction_transform->set_parent(transform);
 }
 
+void IKBone3D::prune_children(const HashSet<const IKBone3D *> &p_kept) {
+	for (int32_t child_i = children.size(); child_i-- > 0;) {
+		Ref<IKBone3D> child = children[child_i];
+		if (p_kept.has(child.ptr())) {
+			continue;
+		}
+		child->_release_descendants();
+		// A child's constraint transform hangs off this bone's transform as well.
+		transform->children.erase(child->transform);
+		transform->children.erase(child->constraint_transform);
+		children.remove_at(child_i);
+	}
+}
+
+void IKBone3D::_release_descendants() {
+	// Bones and transforms reference their children and their parent, so the links down have to be cut for the
+	// subtree to be freed.
+	for (Ref<IKBone3D> child : children) {
+		child->_release_descendants();
+	}
+	children.clear();
+	transform->children.clear();
+	constraint_transform->children.clear();
+	bone_direction_transform->children.clear();
+}
+
+uint64_t IKBone3D::get_memory_usage() const {
+	return sizeof(IKBone3D) + children.size() * sizeof(Ref<IKBone3D>);
+}
+
 float IKBone3D::get_cos_half_dampen() const {
 	return cos_half_dampen;
 }
@@ -160,6 +213,12 @@ Ref<IKKusudama> IKBone3D::get_constraint() const {
 	return constraint;
 }
 
+void IKBone3D::set_flip_handedness(bool p_flip) {
+	const real_t chirality = p_flip ? -1.0 : 1.0;
+	constraint_transform->set_global_chirality(chirality);
+	transform->set_global_chirality(chirality);
+}
+
 void IKBone3D::add_constraint(Ref<IKKusudama> p_constraint) {
 	constraint = p_constraint;
 }
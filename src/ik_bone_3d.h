@@ -37,6 +37,7 @@
 
 #include "core/io/resource.h"
 #include "core/object/ref_counted.h"
+#include "core/templates/hash_set.h"
 #include "scene/3d/skeleton_3d.h"
 
 #define IK_DEFAULT_DAMPENING 0.20944f
@@ -65,6 +66,8 @@ class IKBone3D : public Resource {
 	Ref<IKTransform3D> constraint_transform = memnew(IKTransform3D());
 	Ref<IKTransform3D> transform = memnew(IKTransform3D()); // The bone's actual transform.
 	Ref<IKTransform3D> bone_direction_transform = memnew(IKTransform3D()); // Physical direction of the bone. Calculate Y is the bone up.
+	void _release_descendants();
+
 protected:
 	static void _bind_methods();
 
@@ -75,6 +78,8 @@ public:
 	Ref<IKTransform3D> get_constraint_transform();
 	void add_constraint(Ref<IKKusudama> p_constraint);
 	Ref<IKKusudama> get_constraint() const;
+	// Mirrors the bone's constraint and transform, for constraints authored on the other side of a symmetric skeleton.
+	void set_flip_handedness(bool p_flip);
 	void set_stiffness(float p_stiffness) {
 		stiffness = p_stiffness;
 	}
@@ -93,6 +98,8 @@ public:
 	void set_global_pose(const Transform3D &p_transform);
 	Transform3D get_global_pose() const;
 	void set_initial_pose(Skeleton3D *p_skeleton);
+	// Writes the local pose without invalidating the descendants, for when an ancestor's global pose is set in the same pass.
+	void set_pose_unpropagated(const Transform3D &p_transform);
 	void set_skeleton_bone_pose(Skeleton3D *p_skeleton, real_t p_strength);
 	void create_pin();
 	bool is_pinned() const;
@@ -102,6 +109,11 @@ public:
 	~IKBone3D() {}
 	float get_cos_half_dampen() const;
 	void set_cos_half_dampen(float p_cos_half_dampen);
+	// Drops the child bones that aren't in p_kept, with their whole subtree and transforms, so pose changes stop
+	// propagating into bones the solver never reads.
+	void prune_children(const HashSet<const IKBone3D *> &p_kept);
+	// Bytes held by this bone itself, not by its transforms, pin, constraint or relatives.
+	uint64_t get_memory_usage() const;
 };
 
 #endif // EWBIK_SHADOW_BONE_3D_H
@@ -30,6 +30,9 @@
 
 #include "ik_bone_segment.h"
 #include "ik_effector_3d.h"
+#include "ik_performance.h"
+#include "ik_profiler.h"
+#include "ik_solver_counters.h"
 #include "math/ik_transform.h"
 #include "scene/3d/skeleton_3d.h"
 
@@ -98,6 +101,13 @@ void IKBoneSegment::generate_default_segments_from_root(Vector<Ref<IKEffectorTem
 	create_bone_list(bones, false);
 }
 
+void IKBoneSegment::clear_skeleton() {
+	skeleton = nullptr;
+	for (Ref<IKBoneSegment> child_segment : child_segments) {
+		child_segment->clear_skeleton();
+	}
+}
+
 void IKBoneSegment::create_bone_list(Vector<Ref<IKBone3D>> &p_list, bool p_recursive, bool p_debug_skeleton) const {
 	if (p_recursive) {
 		for (int32_t child_i = 0; child_i < child_segments.size(); child_i++) {
@@ -117,7 +127,7 @@ void IKBoneSegment::create_bone_list(Vector<Ref<IKBone3D>> &p_list, bool p_recur
 		for (int32_t name_i = 0; name_i < list.size(); name_i++) {
 			BoneId bone = list[name_i]->get_bone_id();
 
-			String bone_name = skeleton->get_bone_name(bone);
+			const String bone_name = list[name_i]->get_name();
 			String effector;
 			if (list[name_i]->is_pinned()) {
 				effector += "Effector ";
@@ -161,6 +171,8 @@ void IKBoneSegment::update_pinned_list(Vector<Vector<real_t>> &r_weights) {
 
 void IKBoneSegment::update_optimal_rotation(Ref<IKBone3D> p_for_bone, real_t p_damp, bool p_translate) {
 	ERR_FAIL_NULL(p_for_bone);
+	IK_PROFILE_ZONE_DETAIL("update_optimal_rotation", p_for_bone->get_name());
+	IK_COUNT(bones_solved, 1);
 	update_target_headings(p_for_bone, &heading_weights, &target_headings);
 	update_tip_headings(p_for_bone, &tip_headings);
 	// TODO: fire 2022-09-08 Research apply the rotation if the joint is too constrainted.
@@ -222,10 +234,14 @@ void IKBoneSegment::set_optimal_rotation(Ref<IKBone3D> p_for_bone, PackedVector3
 	ERR_FAIL_NULL(r_htip);
 	ERR_FAIL_NULL(r_htarget);
 	ERR_FAIL_NULL(r_weights);
+	IK_PROFILE_ZONE("set_optimal_rotation");
 	double bone_damp = p_for_bone->get_cos_half_dampen();
 	{
+		IK_PERFORMANCE_STAGE(STAGE_QCP);
 		// Solved ik transform and apply it.
 		QCP qcp = QCP(1E-6, 1E-11);
+		IK_COUNT(qcp_calls, 1);
+		IK_COUNT(qcp_headings, r_htip->size());
 		Quaternion rot = qcp.weighted_superpose(*r_htip, *r_htarget, *r_weights, p_translate);
 		Vector3 translation = qcp.get_translation();
 		if (p_dampening != -1.0f) { // Linter, stop yelling at me. We want the exact bit value of -1.0.
@@ -241,6 +257,7 @@ void IKBoneSegment::set_optimal_rotation(Ref<IKBone3D> p_for_bone, PackedVector3
 
 	// If the solved transform is outside the hard constraints, move it back into range.
 	if (p_for_bone->get_constraint().is_valid() && p_for_bone->get_constraint_transform().is_valid()) {
+		IK_PERFORMANCE_STAGE(STAGE_CONSTRAINTS);
 		if (!p_for_bone->get_constraint()->get_limit_cones().is_empty()) {
 			Vector3 control_point = p_for_bone->get_constraint_transform()->to_global(p_for_bone->get_constraint()->get_limit_cones()[0]->get_control_point());
 			control_point -= p_for_bone->get_constraint_transform()->get_global_transform().origin;
@@ -275,18 +292,43 @@ void IKBoneSegment::update_tip_headings(Ref<IKBone3D> p_for_bone, PackedVector3A
 	}
 }
 
-void IKBoneSegment::segment_solver(real_t p_damp) {
+real_t IKBoneSegment::get_scheduled_damp(real_t p_initial_damp, real_t p_damp, int32_t p_iteration, int32_t p_iterations) {
+	if (p_initial_damp <= 0.0 || p_iterations <= 1) {
+		return p_damp;
+	}
+	return Math::lerp(p_initial_damp, p_damp, MIN(real_t(p_iteration) / (p_iterations - 1), real_t(1.0)));
+}
+
+bool IKBoneSegment::segment_solver(real_t p_damp, real_t p_tolerance) {
+	IK_PROFILE_ZONE_DETAIL("segment_solver", get_name());
+	bool solved_child = false;
 	for (Ref<IKBoneSegment> child : child_segments) {
-		child->segment_solver(p_damp);
+		solved_child = child->segment_solver(p_damp, p_tolerance) || solved_child;
+	}
+	// A segment still far from its targets needs its ancestors to keep moving too, so only skip when the whole subtree has
+	// settled.
+	if (p_tolerance > 0.0 && !solved_child && get_residual_error() <= p_tolerance) {
+		IK_COUNT(converged_segments, 1);
+		return false;
 	}
 	bool is_translate = parent_segment.is_null();
 	if (is_translate) {
 		p_damp = Math_PI;
 	}
 	qcp_solver(p_damp, is_translate);
+	return true;
+}
+
+real_t IKBoneSegment::get_residual_error() const {
+	real_t error = 0.0;
+	for (const Ref<IKEffector3D> &effector : effector_list) {
+		error = MAX(error, effector->get_weighted_error());
+	}
+	return error;
 }
 
 void IKBoneSegment::qcp_solver(real_t p_damp, bool p_translate) {
+	IK_PROFILE_ZONE("qcp_solver");
 	for (Ref<IKBone3D> current_bone : bones) {
 		update_optimal_rotation(current_bone, p_damp, p_translate && current_bone == root);
 	}
@@ -330,6 +372,58 @@ Vector<Ref<IKBone3D>> IKBoneSegment::get_bone_list() const {
 	return bones;
 }
 
+template <typename T>
+static uint64_t _vector_memory_usage(const Vector<T> &p_vector) {
+	return p_vector.is_empty() ? 0 : p_vector.size() * sizeof(T) + 2 * sizeof(uint32_t);
+}
+
+void IKBoneSegment::get_memory_usage(MemoryUsage &r_usage) const {
+	r_usage.segments += sizeof(IKBoneSegment) + _vector_memory_usage(bones) + _vector_memory_usage(pinned_bones) + _vector_memory_usage(child_segments) + _vector_memory_usage(effector_list);
+	r_usage.segments += bone_map.size() * (sizeof(HashMapElement<BoneId, Ref<IKBone3D>>) + sizeof(uint32_t) + sizeof(void *));
+	r_usage.headings += _vector_memory_usage(target_headings) + _vector_memory_usage(tip_headings) + _vector_memory_usage(heading_weights);
+	for (const Ref<IKBone3D> &bone : bones) {
+		r_usage.bones += bone->get_memory_usage();
+		if (bone->is_pinned()) {
+			r_usage.bones += sizeof(IKEffector3D);
+		}
+		r_usage.transforms += bone->get_ik_transform()->get_memory_usage() + bone->get_constraint_transform()->get_memory_usage() + bone->get_bone_direction_transform()->get_memory_usage();
+		const Ref<IKKusudama> constraint = bone->get_constraint();
+		if (constraint.is_null()) {
+			continue;
+		}
+		r_usage.constraints += constraint->get_memory_usage();
+		// Cones shared through an IKCompiledRig are counted apart, since every rig using the configuration holds them.
+		const uint64_t cone_usage = constraint->get_limit_cones().size() * sizeof(LimitCone);
+		if (constraint->has_shared_limit_cones()) {
+			r_usage.shared_constraints += cone_usage;
+		} else {
+			r_usage.constraints += cone_usage;
+		}
+	}
+	for (const Ref<IKBoneSegment> &child_segment : child_segments) {
+		child_segment->get_memory_usage(r_usage);
+	}
+}
+
+void IKBoneSegment::prune_unsolved_bones(const Vector<Ref<IKBone3D>> &p_bone_list) {
+	HashSet<const IKBone3D *> kept;
+	for (const Ref<IKBone3D> &bone : p_bone_list) {
+		kept.insert(bone.ptr());
+	}
+	for (const Ref<IKBone3D> &bone : p_bone_list) {
+		bone->prune_children(kept);
+	}
+	Vector<BoneId> unsolved_bones;
+	for (const KeyValue<BoneId, Ref<IKBone3D>> &E : bone_map) {
+		if (!kept.has(E.value.ptr())) {
+			unsolved_bones.push_back(E.key);
+		}
+	}
+	for (BoneId bone_id : unsolved_bones) {
+		bone_map.erase(bone_id);
+	}
+}
+
 Ref<IKBone3D> IKBoneSegment::get_ik_bone(BoneId p_bone) {
 	if (!bone_map.has(p_bone)) {
 		return Ref<IKBone3D>();
@@ -420,3 +514,39 @@ void IKBoneSegment::recursive_create_headings_arrays_for(Ref<IKBoneSegment> p_bo
 		recursive_create_headings_arrays_for(segments);
 	}
 }
+
+void IKBoneSegment::update_heading_weights() {
+	int32_t heading_count = recursive_update_penalty_weights(this, 0, 1.0);
+	ERR_FAIL_COND_MSG(heading_count != heading_weights.size(), "The heading layout changed, the headings arrays must be recreated.");
+}
+
+int32_t IKBoneSegment::recursive_update_penalty_weights(Ref<IKBoneSegment> p_bone_segment, int32_t p_index, real_t p_falloff) {
+	// Walks the segments in the same order as recursive_create_penalty_array() so each pin writes its own slice.
+	if (p_falloff <= 0.0) {
+		return p_index;
+	}
+	int32_t index = p_index;
+	real_t current_falloff = 1.0;
+	if (p_bone_segment->is_pinned()) {
+		Ref<IKEffector3D> pin = p_bone_segment->get_tip()->get_pin();
+		index = pin->update_effector_heading_weights(&heading_weights, index, p_falloff);
+		ERR_FAIL_COND_V(index == -1, -1);
+		current_falloff = pin->get_depth_falloff();
+	}
+	for (Ref<IKBoneSegment> s : p_bone_segment->get_child_segments()) {
+		index = recursive_update_penalty_weights(s, index, p_falloff * current_falloff);
+		ERR_FAIL_COND_V(index == -1, -1);
+	}
+	return index;
+}
+
+const Vector<real_t> &IKBoneSegment::get_heading_weights() const {
+	return heading_weights;
+}
+
+void IKBoneSegment::recursive_update_heading_weights_for(Ref<IKBoneSegment> p_bone_segment) {
+	p_bone_segment->update_heading_weights();
+	for (Ref<IKBoneSegment> segments : p_bone_segment->get_child_segments()) {
+		recursive_update_heading_weights_for(segments);
+	}
+}
@@ -71,6 +71,7 @@ class IKBoneSegment : public Resource {
 	void qcp_solver(real_t p_damp, bool p_translate);
 	void update_optimal_rotation(Ref<IKBone3D> p_for_bone, real_t p_damp, bool p_translate);
 	float get_manual_msd(const PackedVector3Array &r_htip, const PackedVector3Array &r_htarget, const Vector<real_t> &p_weights);
+	int32_t recursive_update_penalty_weights(Ref<IKBoneSegment> p_bone_segment, int32_t p_index, real_t p_falloff);
 	HashMap<BoneId, Ref<IKBone3D>> bone_map;
 	// This orientation angle is a cos(angle/2) representation.
 	Quaternion set_quadrance_angle(Quaternion p_quat, real_t p_cos_half_angle) const;
@@ -80,6 +81,9 @@ protected:
 
 public:
 	static Quaternion clamp_to_angle(Quaternion p_quat, real_t p_angle);
+	// The damp of iteration p_iteration of p_iterations, going linearly from p_initial_damp down to p_damp on the last
+	// one. A p_initial_damp of zero keeps p_damp throughout.
+	static real_t get_scheduled_damp(real_t p_initial_damp, real_t p_damp, int32_t p_iteration, int32_t p_iterations);
 	static Quaternion clamp_to_quadrance_angle(Quaternion p_quat, real_t p_cos_half_angle);
 	_FORCE_INLINE_ static real_t cos(real_t p_angle) {
 		// https://stackoverflow.com/questions/18662261/fastest-implementation-of-sine-cosine-and-square-root-in-c-doesnt-need-to-b/28050328#28050328
@@ -106,16 +110,37 @@ public:
 #endif
 		return y;
 	}
+	// Approximate heap bytes, split the way EWBIK::get_memory_usage reports them.
+	struct MemoryUsage {
+		uint64_t segments = 0;
+		uint64_t bones = 0;
+		uint64_t transforms = 0;
+		uint64_t headings = 0;
+		uint64_t constraints = 0;
+		uint64_t shared_constraints = 0;
+	};
+	void get_memory_usage(MemoryUsage &r_usage) const;
+	// Frees the bones that were created while walking the skeleton but ended up outside every kept segment.
+	void prune_unsolved_bones(const Vector<Ref<IKBone3D>> &p_bone_list);
 	static void recursive_create_headings_arrays_for(Ref<IKBoneSegment> p_bone_segment);
 	void create_headings_arrays();
+	static void recursive_update_heading_weights_for(Ref<IKBoneSegment> p_bone_segment);
+	void update_heading_weights();
+	const Vector<real_t> &get_heading_weights() const;
 	void recursive_create_penalty_array(Ref<IKBoneSegment> p_bone_segment, Vector<Vector<real_t>> &r_penalty_array, Vector<Ref<IKBone3D>> &r_pinned_bones, real_t p_falloff);
 	Ref<IKBoneSegment> get_parent_segment();
-	void segment_solver(real_t p_damp);
+	// Returns false when every segment was within p_tolerance and nothing was solved. Zero solves every segment.
+	bool segment_solver(real_t p_damp, real_t p_tolerance = 0.0);
+	// The largest weighted error among the pins this segment solves for.
+	real_t get_residual_error() const;
 	Ref<IKBone3D> get_root() const;
 	Ref<IKBone3D> get_tip() const;
 	bool is_pinned() const;
 	Vector<Ref<IKBoneSegment>> get_child_segments() const;
 	void create_bone_list(Vector<Ref<IKBone3D>> &p_list, bool p_recursive = false, bool p_debug_skeleton = false) const;
+	// The skeleton is only read while the segments are generated. Dropping it afterwards keeps the segments from pointing
+	// at a skeleton that was freed.
+	void clear_skeleton();
 	Vector<Ref<IKBone3D>> get_bone_list() const;
 	Ref<IKBone3D> get_ik_bone(BoneId p_bone);
 	void generate_default_segments_from_root(Vector<Ref<IKEffectorTemplate>> &p_pins, BoneId p_root_bone, BoneId p_tip_bone);
@@ -0,0 +1,487 @@
+/*************************************************************************/
+/*  ik_compiled_rig.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_compiled_rig.h"
+
+#include "core/templates/hashfuncs.h"
+#include "kusudama.h"
+
+Mutex IKCompiledRig::cache_mutex;
+HashMap<uint32_t, Ref<IKCompiledRig>> IKCompiledRig::cache;
+
+static uint32_t _hash_transform(const Transform3D &p_transform, uint32_t p_hash) {
+	for (int32_t axis_i = 0; axis_i < 3; axis_i++) {
+		p_hash = hash_murmur3_one_real(p_transform.basis[axis_i].x, p_hash);
+		p_hash = hash_murmur3_one_real(p_transform.basis[axis_i].y, p_hash);
+		p_hash = hash_murmur3_one_real(p_transform.basis[axis_i].z, p_hash);
+	}
+	p_hash = hash_murmur3_one_real(p_transform.origin.x, p_hash);
+	p_hash = hash_murmur3_one_real(p_transform.origin.y, p_hash);
+	return hash_murmur3_one_real(p_transform.origin.z, p_hash);
+}
+
+void IKCompiledRig::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_root_bone"), &IKCompiledRig::get_root_bone);
+	ClassDB::bind_method(D_METHOD("get_skeleton_hash"), &IKCompiledRig::get_skeleton_hash);
+	ClassDB::bind_method(D_METHOD("get_configuration_hash"), &IKCompiledRig::get_configuration_hash);
+	ClassDB::bind_method(D_METHOD("get_constraint_count"), &IKCompiledRig::get_constraint_count);
+	ClassDB::bind_static_method("IKCompiledRig", D_METHOD("get_cache_size"), &IKCompiledRig::get_cache_size);
+	ClassDB::bind_static_method("IKCompiledRig", D_METHOD("clear_cache"), &IKCompiledRig::clear_cache);
+}
+
+uint32_t IKCompiledRig::hash_skeleton(Skeleton3D *p_skeleton) {
+	ERR_FAIL_NULL_V(p_skeleton, 0);
+	uint32_t hash = hash_murmur3_one_32(p_skeleton->get_bone_count());
+	for (int32_t bone_i = 0; bone_i < p_skeleton->get_bone_count(); bone_i++) {
+		hash = hash_murmur3_one_32(p_skeleton->get_bone_name(bone_i).hash(), hash);
+		hash = hash_murmur3_one_32(p_skeleton->get_bone_parent(bone_i), hash);
+		hash = _hash_transform(p_skeleton->get_bone_rest(bone_i), hash);
+	}
+	return hash_fmix32(hash);
+}
+
+uint32_t IKCompiledRig::hash_configuration(uint32_t p_skeleton_hash, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones) {
+	uint32_t hash = hash_murmur3_one_32(p_skeleton_hash);
+	hash = hash_murmur3_one_32(p_root_bone.hash(), hash);
+	hash = hash_murmur3_one_32(p_constraint_names.size(), hash);
+	for (int32_t constraint_i = 0; constraint_i < p_constraint_names.size(); constraint_i++) {
+		hash = hash_murmur3_one_32(p_constraint_names[constraint_i].hash(), hash);
+		hash = hash_murmur3_one_real(p_kusudama_twist[constraint_i].x, hash);
+		hash = hash_murmur3_one_real(p_kusudama_twist[constraint_i].y, hash);
+		hash = hash_murmur3_one_32(p_kusudama_flip_handedness[constraint_i], hash);
+		const Vector<Vector4> &cones = p_kusudama_limit_cones[constraint_i];
+		hash = hash_murmur3_one_32(cones.size(), hash);
+		for (const Vector4 &cone : cones) {
+			hash = hash_murmur3_one_real(cone.x, hash);
+			hash = hash_murmur3_one_real(cone.y, hash);
+			hash = hash_murmur3_one_real(cone.z, hash);
+			hash = hash_murmur3_one_real(cone.w, hash);
+		}
+	}
+	return hash_fmix32(hash);
+}
+
+bool IKCompiledRig::matches(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones) const {
+	ERR_FAIL_NULL_V(p_skeleton, false);
+	if (root_bone != p_root_bone || constraints.size() != p_constraint_names.size()) {
+		return false;
+	}
+	if (bone_count != p_skeleton->get_bone_count() || root_bone_id != p_skeleton->find_bone(p_root_bone) || skeleton_hash != hash_skeleton(p_skeleton)) {
+		return false;
+	}
+	for (int32_t constraint_i = 0; constraint_i < constraints.size(); constraint_i++) {
+		const Constraint &constraint = constraints[constraint_i];
+		if (constraint.bone_name != p_constraint_names[constraint_i] || constraint.twist != p_kusudama_twist[constraint_i] || constraint.flip_handedness != p_kusudama_flip_handedness[constraint_i] || constraint.limit_cone_settings != p_kusudama_limit_cones[constraint_i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Vector3 IKCompiledRig::localize_limit_cone_point(Skeleton3D *p_skeleton, BoneId p_parent, BoneId p_bone, Vector3 p_point) {
+	ERR_FAIL_NULL_V(p_skeleton, p_point);
+	if (p_parent == -1 || p_bone == -1) {
+		return p_point;
+	}
+	const Transform3D parent_rest = p_skeleton->get_bone_global_rest(p_parent);
+	const Transform3D bone_rest = p_skeleton->get_bone_global_rest(p_bone);
+	Vector3 globalized_point = parent_rest.xform(p_point);
+	globalized_point += parent_rest.origin - bone_rest.origin;
+	return bone_rest.affine_inverse().xform(globalized_point);
+}
+
+Ref<IKKusudama> IKCompiledRig::attach_constraint(const Constraint &p_constraint, const Ref<IKBone3D> &p_bone) {
+	ERR_FAIL_NULL_V(p_bone, Ref<IKKusudama>());
+	Ref<IKKusudama> constraint = memnew(IKKusudama(p_bone));
+	constraint->enable_axial_limits();
+	if (!p_constraint.limit_cones.is_empty()) {
+		constraint->enable_orientational_limits();
+	}
+	constraint->set_shared_limit_cones(p_constraint.limit_cones);
+	// Also updates the rotational freedom.
+	constraint->set_axial_limits(p_constraint.twist.x, p_constraint.twist.y);
+	p_bone->add_constraint(constraint);
+	p_bone->set_flip_handedness(p_constraint.flip_handedness);
+	return constraint;
+}
+
+void IKCompiledRig::patch_constraint(Skeleton3D *p_skeleton, const Ref<IKBone3D> &p_bone, const Vector<Vector4> &p_limit_cones, const Vector2 &p_twist) {
+	ERR_FAIL_NULL(p_bone);
+	Ref<IKKusudama> kusudama = p_bone->get_constraint();
+	ERR_FAIL_NULL(kusudama);
+	// Localized at rest like compile() does, so edits agree with freshly compiled rigs.
+	const BoneId parent_id = p_bone->get_parent().is_valid() ? p_bone->get_parent()->get_bone_id() : -1;
+	if (kusudama->get_limit_cones().size() != p_limit_cones.size()) {
+		kusudama->clear_limit_cones();
+		for (const Vector4 &cone : p_limit_cones) {
+			kusudama->add_limit_cone_at_index(0, localize_limit_cone_point(p_skeleton, parent_id, p_bone->get_bone_id(), Vector3(cone.x, cone.y, cone.z)), cone.w);
+		}
+	} else {
+		// The kusudama holds the cones in reverse order.
+		for (int32_t cone_i = 0; cone_i < p_limit_cones.size(); cone_i++) {
+			const Vector4 &cone = p_limit_cones[cone_i];
+			kusudama->set_limit_cone(p_limit_cones.size() - 1 - cone_i, localize_limit_cone_point(p_skeleton, parent_id, p_bone->get_bone_id(), Vector3(cone.x, cone.y, cone.z)), cone.w);
+		}
+	}
+	if (!p_limit_cones.is_empty()) {
+		kusudama->enable_orientational_limits();
+	}
+	// Also refreshes the tangent radii and the rotational freedom.
+	kusudama->set_axial_limits(p_twist.x, p_twist.y);
+}
+
+Ref<IKCompiledRig> IKCompiledRig::compile(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones) {
+	ERR_FAIL_NULL_V(p_skeleton, Ref<IKCompiledRig>());
+	const int32_t constraint_count = p_constraint_names.size();
+	ERR_FAIL_COND_V(p_kusudama_twist.size() != constraint_count || p_kusudama_flip_handedness.size() != constraint_count || p_kusudama_limit_cones.size() != constraint_count, Ref<IKCompiledRig>());
+	Ref<IKCompiledRig> rig;
+	rig.instantiate();
+	rig->root_bone = p_root_bone;
+	rig->skeleton_hash = hash_skeleton(p_skeleton);
+	rig->bone_count = p_skeleton->get_bone_count();
+	rig->root_bone_id = p_skeleton->find_bone(p_root_bone);
+	rig->configuration_hash = hash_configuration(rig->skeleton_hash, p_root_bone, p_constraint_names, p_kusudama_twist, p_kusudama_flip_handedness, p_kusudama_limit_cones);
+	const BoneId root_bone_id = rig->root_bone_id;
+	rig->constraints.resize(constraint_count);
+	for (int32_t constraint_i = 0; constraint_i < constraint_count; constraint_i++) {
+		Constraint &constraint = rig->constraints.write[constraint_i];
+		constraint.bone_name = p_constraint_names[constraint_i];
+		constraint.bone_id = p_skeleton->find_bone(constraint.bone_name);
+		constraint.twist = p_kusudama_twist[constraint_i];
+		constraint.flip_handedness = p_kusudama_flip_handedness[constraint_i];
+		constraint.limit_cone_settings = p_kusudama_limit_cones[constraint_i];
+		if (constraint.bone_id == -1) {
+			continue;
+		}
+		// The chain's root has no parent in the shadow skeleton, so its cones are left as given.
+		const BoneId parent_id = constraint.bone_id == root_bone_id ? -1 : p_skeleton->get_bone_parent(constraint.bone_id);
+		const Vector<Vector4> &settings = constraint.limit_cone_settings;
+		constraint.limit_cones.resize(settings.size());
+		for (int32_t cone_i = 0; cone_i < settings.size(); cone_i++) {
+			const Vector4 &setting = settings[cone_i];
+			Vector3 point = localize_limit_cone_point(p_skeleton, parent_id, constraint.bone_id, Vector3(setting.x, setting.y, setting.z));
+			constraint.limit_cones.write[settings.size() - 1 - cone_i] = Ref<LimitCone>(memnew(LimitCone(point, setting.w)));
+		}
+		for (int32_t cone_i = 0; cone_i < constraint.limit_cones.size(); cone_i++) {
+			Ref<LimitCone> next;
+			if (cone_i < constraint.limit_cones.size() - 1) {
+				next = constraint.limit_cones[cone_i + 1];
+			}
+			constraint.limit_cones[cone_i]->update_tangent_handles(next);
+		}
+	}
+	return rig;
+}
+
+Ref<IKCompiledRig> IKCompiledRig::find_or_compile(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones) {
+	ERR_FAIL_NULL_V(p_skeleton, Ref<IKCompiledRig>());
+	const uint32_t skeleton_hash = hash_skeleton(p_skeleton);
+	const uint32_t key = hash_configuration(skeleton_hash, p_root_bone, p_constraint_names, p_kusudama_twist, p_kusudama_flip_handedness, p_kusudama_limit_cones);
+	{
+		MutexLock lock(cache_mutex);
+		const Ref<IKCompiledRig> *cached = cache.getptr(key);
+		if (cached && (*cached)->matches(p_skeleton, p_root_bone, p_constraint_names, p_kusudama_twist, p_kusudama_flip_handedness, p_kusudama_limit_cones)) {
+			return *cached;
+		}
+	}
+	// Compile outside the lock; if two threads race on the same configuration, the first one to finish wins.
+	Ref<IKCompiledRig> rig = compile(p_skeleton, p_root_bone, p_constraint_names, p_kusudama_twist, p_kusudama_flip_handedness, p_kusudama_limit_cones);
+	ERR_FAIL_NULL_V(rig, Ref<IKCompiledRig>());
+	MutexLock lock(cache_mutex);
+	const Ref<IKCompiledRig> *cached = cache.getptr(key);
+	if (cached && (*cached)->matches(p_skeleton, p_root_bone, p_constraint_names, p_kusudama_twist, p_kusudama_flip_handedness, p_kusudama_limit_cones)) {
+		return *cached;
+	}
+	// Drop the rigs that no instance uses anymore.
+	Vector<uint32_t> unused_keys;
+	for (const KeyValue<uint32_t, Ref<IKCompiledRig>> &E : cache) {
+		if (E.value->get_reference_count() == 1) {
+			unused_keys.push_back(E.key);
+		}
+	}
+	for (uint32_t unused_key : unused_keys) {
+		cache.erase(unused_key);
+	}
+	cache.insert(key, rig);
+	return rig;
+}
+
+void IKCompiledRig::_store_limit_cone(Ref<FileAccess> p_file, const Ref<LimitCone> &p_cone) {
+	const Vector3 points[] = {
+		p_cone->control_point,
+		p_cone->tangent_circle_center_next_1,
+		p_cone->tangent_circle_center_next_2,
+		p_cone->cushion_tangent_circle_center_next_1,
+		p_cone->cushion_tangent_circle_center_next_2,
+		p_cone->cushion_tangent_circle_center_previous_1,
+		p_cone->cushion_tangent_circle_center_previous_2,
+	};
+	for (const Vector3 &point : points) {
+		p_file->store_double(point.x);
+		p_file->store_double(point.y);
+		p_file->store_double(point.z);
+	}
+	const double values[] = {
+		p_cone->radius,
+		p_cone->radius_cosine,
+		p_cone->cushion_radius,
+		p_cone->cushion_cosine,
+		p_cone->tangent_circle_radius_next,
+		p_cone->tangent_circle_radius_next_cos,
+		p_cone->cushion_tangent_circle_radius_next,
+		p_cone->cushion_tangent_circle_radius_next_cos,
+	};
+	for (double value : values) {
+		p_file->store_double(value);
+	}
+	for (const Vector3 *triangle : { p_cone->first_triangle_next, p_cone->second_triangle_next }) {
+		for (int32_t point_i = 0; point_i < 3; point_i++) {
+			const Vector3 &point = triangle[point_i];
+			p_file->store_double(point.x);
+			p_file->store_double(point.y);
+			p_file->store_double(point.z);
+		}
+	}
+}
+
+// Smallest on-disk size of each record, so a corrupt count can't ask for more records than the file could hold.
+static const uint64_t CONSTRAINT_MIN_SIZE = 4 + 4 + 2 * 8 + 1 + 4 + 4;
+static const uint64_t LIMIT_CONE_SETTING_SIZE = 4 * 8;
+static const uint64_t LIMIT_CONE_SIZE = (7 * 3 + 8 + 2 * 3 * 3) * 8;
+
+static bool _read_count(Ref<FileAccess> p_file, uint64_t p_record_size, int32_t &r_count) {
+	const uint32_t count = p_file->get_32();
+	const uint64_t remaining = p_file->get_length() - p_file->get_position();
+	if (p_file->eof_reached() || count > remaining / p_record_size) {
+		return false;
+	}
+	r_count = int32_t(count);
+	return true;
+}
+
+Ref<LimitCone> IKCompiledRig::_load_limit_cone(Ref<FileAccess> p_file) {
+	Ref<LimitCone> cone;
+	cone.instantiate();
+	Vector3 *points[] = {
+		&cone->control_point,
+		&cone->tangent_circle_center_next_1,
+		&cone->tangent_circle_center_next_2,
+		&cone->cushion_tangent_circle_center_next_1,
+		&cone->cushion_tangent_circle_center_next_2,
+		&cone->cushion_tangent_circle_center_previous_1,
+		&cone->cushion_tangent_circle_center_previous_2,
+	};
+	for (Vector3 *point : points) {
+		point->x = p_file->get_double();
+		point->y = p_file->get_double();
+		point->z = p_file->get_double();
+	}
+	double *values[] = {
+		&cone->radius,
+		&cone->radius_cosine,
+		&cone->cushion_radius,
+		&cone->cushion_cosine,
+		&cone->tangent_circle_radius_next,
+		&cone->tangent_circle_radius_next_cos,
+		&cone->cushion_tangent_circle_radius_next,
+		&cone->cushion_tangent_circle_radius_next_cos,
+	};
+	for (double *value : values) {
+		*value = p_file->get_double();
+	}
+	for (Vector3 *triangle : { cone->first_triangle_next, cone->second_triangle_next }) {
+		for (int32_t point_i = 0; point_i < 3; point_i++) {
+			Vector3 &point = triangle[point_i];
+			point.x = p_file->get_double();
+			point.y = p_file->get_double();
+			point.z = p_file->get_double();
+		}
+	}
+	return cone;
+}
+
+Error IKCompiledRig::save_to_file(const String &p_path) const {
+	Error err;
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot save compiled IK rig to file '" + p_path + "'.");
+	file->store_buffer((const uint8_t *)"EWIR", 4);
+	file->store_32(FORMAT_VERSION);
+	file->store_32(skeleton_hash);
+	file->store_32(bone_count);
+	file->store_32(root_bone_id);
+	file->store_32(configuration_hash);
+	file->store_pascal_string(root_bone);
+	file->store_32(constraints.size());
+	for (const Constraint &constraint : constraints) {
+		file->store_pascal_string(constraint.bone_name);
+		file->store_32(constraint.bone_id);
+		file->store_double(constraint.twist.x);
+		file->store_double(constraint.twist.y);
+		file->store_8(constraint.flip_handedness);
+		file->store_32(constraint.limit_cone_settings.size());
+		for (const Vector4 &setting : constraint.limit_cone_settings) {
+			file->store_double(setting.x);
+			file->store_double(setting.y);
+			file->store_double(setting.z);
+			file->store_double(setting.w);
+		}
+		file->store_32(constraint.limit_cones.size());
+		for (const Ref<LimitCone> &cone : constraint.limit_cones) {
+			_store_limit_cone(file, cone);
+		}
+	}
+	return file->get_error() == OK || file->get_error() == ERR_FILE_EOF ? OK : ERR_FILE_CANT_WRITE;
+}
+
+Ref<IKCompiledRig> IKCompiledRig::load_from_file(const String &p_path, Error *r_error) {
+	if (r_error) {
+		*r_error = ERR_FILE_CORRUPT;
+	}
+	Error err;
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ, &err);
+	if (err != OK) {
+		if (r_error) {
+			*r_error = err;
+		}
+		ERR_FAIL_V_MSG(Ref<IKCompiledRig>(), "Cannot open compiled IK rig file '" + p_path + "'.");
+	}
+	uint8_t magic[4];
+	file->get_buffer(magic, 4);
+	ERR_FAIL_COND_V_MSG(magic[0] != 'E' || magic[1] != 'W' || magic[2] != 'I' || magic[3] != 'R', Ref<IKCompiledRig>(), "'" + p_path + "' is not a compiled IK rig.");
+	const uint32_t version = file->get_32();
+	ERR_FAIL_COND_V_MSG(version != FORMAT_VERSION, Ref<IKCompiledRig>(), vformat("Compiled IK rig '%s' has format version %d, expected %d. Bake it again.", p_path, version, FORMAT_VERSION));
+	Ref<IKCompiledRig> rig;
+	rig.instantiate();
+	rig->skeleton_hash = file->get_32();
+	rig->bone_count = int32_t(file->get_32());
+	rig->root_bone_id = int32_t(file->get_32());
+	rig->configuration_hash = file->get_32();
+	rig->root_bone = file->get_pascal_string();
+	int32_t constraint_count = 0;
+	ERR_FAIL_COND_V_MSG(!_read_count(file, CONSTRAINT_MIN_SIZE, constraint_count), Ref<IKCompiledRig>(), "Compiled IK rig '" + p_path + "' is corrupt.");
+	rig->constraints.resize(constraint_count);
+	for (int32_t constraint_i = 0; constraint_i < rig->constraints.size(); constraint_i++) {
+		Constraint &constraint = rig->constraints.write[constraint_i];
+		constraint.bone_name = file->get_pascal_string();
+		constraint.bone_id = int32_t(file->get_32());
+		constraint.twist.x = file->get_double();
+		constraint.twist.y = file->get_double();
+		constraint.flip_handedness = file->get_8();
+		int32_t setting_count = 0;
+		ERR_FAIL_COND_V_MSG(!_read_count(file, LIMIT_CONE_SETTING_SIZE, setting_count), Ref<IKCompiledRig>(), "Compiled IK rig '" + p_path + "' is corrupt.");
+		constraint.limit_cone_settings.resize(setting_count);
+		for (int32_t setting_i = 0; setting_i < constraint.limit_cone_settings.size(); setting_i++) {
+			Vector4 &setting = constraint.limit_cone_settings.write[setting_i];
+			setting.x = file->get_double();
+			setting.y = file->get_double();
+			setting.z = file->get_double();
+			setting.w = file->get_double();
+		}
+		int32_t cone_count = 0;
+		ERR_FAIL_COND_V_MSG(!_read_count(file, LIMIT_CONE_SIZE, cone_count), Ref<IKCompiledRig>(), "Compiled IK rig '" + p_path + "' is corrupt.");
+		constraint.limit_cones.resize(cone_count);
+		for (int32_t cone_i = 0; cone_i < constraint.limit_cones.size(); cone_i++) {
+			constraint.limit_cones.write[cone_i] = _load_limit_cone(file);
+		}
+		ERR_FAIL_COND_V_MSG(file->eof_reached(), Ref<IKCompiledRig>(), "Compiled IK rig '" + p_path + "' is truncated.");
+	}
+	if (r_error) {
+		*r_error = OK;
+	}
+	return rig;
+}
+
+int32_t IKCompiledRig::get_cache_size() {
+	MutexLock lock(cache_mutex);
+	return cache.size();
+}
+
+void IKCompiledRig::clear_cache() {
+	MutexLock lock(cache_mutex);
+	cache.clear();
+}
+
+StringName IKCompiledRig::get_root_bone() const {
+	return root_bone;
+}
+
+uint32_t IKCompiledRig::get_skeleton_hash() const {
+	return skeleton_hash;
+}
+
+uint32_t IKCompiledRig::get_configuration_hash() const {
+	return configuration_hash;
+}
+
+int32_t IKCompiledRig::get_constraint_count() const {
+	return constraints.size();
+}
+
+const Vector<IKCompiledRig::Constraint> &IKCompiledRig::get_constraints() const {
+	return constraints;
+}
+
+IKCompiledRig::IKCompiledRig() {
+}
+
+Ref<Resource> ResourceFormatLoaderIKCompiledRig::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, CacheMode p_cache_mode) {
+	return IKCompiledRig::load_from_file(p_path, r_error);
+}
+
+void ResourceFormatLoaderIKCompiledRig::get_recognized_extensions(List<String> *p_extensions) const {
+	p_extensions->push_back("ikrig");
+}
+
+bool ResourceFormatLoaderIKCompiledRig::handles_type(const String &p_type) const {
+	return ClassDB::is_parent_class(p_type, "IKCompiledRig");
+}
+
+String ResourceFormatLoaderIKCompiledRig::get_resource_type(const String &p_path) const {
+	if (p_path.get_extension().to_lower() == "ikrig") {
+		return "IKCompiledRig";
+	}
+	return "";
+}
+
+Error ResourceFormatSaverIKCompiledRig::save(const Ref<Resource> &p_resource, const String &p_path, uint32_t p_flags) {
+	Ref<IKCompiledRig> rig = p_resource;
+	ERR_FAIL_NULL_V(rig, ERR_INVALID_PARAMETER);
+	return rig->save_to_file(p_path);
+}
+
+void ResourceFormatSaverIKCompiledRig::get_recognized_extensions(const Ref<Resource> &p_resource, List<String> *p_extensions) const {
+	if (Object::cast_to<IKCompiledRig>(*p_resource)) {
+		p_extensions->push_back("ikrig");
+	}
+}
+
+bool ResourceFormatSaverIKCompiledRig::recognize(const Ref<Resource> &p_resource) const {
+	return Object::cast_to<IKCompiledRig>(*p_resource) != nullptr;
+}
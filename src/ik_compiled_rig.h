@@ -0,0 +1,124 @@
+/*************************************************************************/
+/*  ik_compiled_rig.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_COMPILED_RIG_H
+#define IK_COMPILED_RIG_H
+
+#include "core/io/file_access.h"
+#include "core/io/resource.h"
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+#include "scene/3d/skeleton_3d.h"
+
+#include "limit_cone.h"
+
+// The parts of a compiled rig that only depend on the skeleton's rest and the rig settings.
+// Instances with the same configuration share one, so it must not be modified once compiled.
+class IKCompiledRig : public Resource {
+	GDCLASS(IKCompiledRig, Resource);
+
+public:
+	struct Constraint {
+		StringName bone_name;
+		BoneId bone_id = -1;
+		Vector2 twist;
+		bool flip_handedness = false;
+		Vector<Vector4> limit_cone_settings;
+		// In the kusudama's order, which is the reverse of limit_cone_settings.
+		Vector<Ref<LimitCone>> limit_cones;
+	};
+
+private:
+	StringName root_bone;
+	// Checked along with the hash, so a hash collision can't attach the rig to another skeleton.
+	uint32_t skeleton_hash = 0;
+	int32_t bone_count = 0;
+	BoneId root_bone_id = -1;
+	uint32_t configuration_hash = 0;
+	Vector<Constraint> constraints;
+
+	static Mutex cache_mutex;
+	static HashMap<uint32_t, Ref<IKCompiledRig>> cache;
+
+	static void _store_limit_cone(Ref<FileAccess> p_file, const Ref<LimitCone> &p_cone);
+	static Ref<LimitCone> _load_limit_cone(Ref<FileAccess> p_file);
+
+protected:
+	static void _bind_methods();
+
+public:
+	static const uint32_t FORMAT_VERSION = 2;
+
+	static uint32_t hash_skeleton(Skeleton3D *p_skeleton);
+	static uint32_t hash_configuration(uint32_t p_skeleton_hash, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones);
+	// Moves a limit cone center from the parent's rest frame into the bone's, matching IKKusudama::add_limit_cone() at rest.
+	static Vector3 localize_limit_cone_point(Skeleton3D *p_skeleton, BoneId p_parent, BoneId p_bone, Vector3 p_point);
+	// Gives p_bone a kusudama built from p_constraint, sharing its limit cones.
+	static Ref<IKKusudama> attach_constraint(const Constraint &p_constraint, const Ref<IKBone3D> &p_bone);
+	// Rewrites the limit cones and twist of p_bone's kusudama in place to match what attach_constraint() would build from
+	// the same settings.
+	static void patch_constraint(Skeleton3D *p_skeleton, const Ref<IKBone3D> &p_bone, const Vector<Vector4> &p_limit_cones, const Vector2 &p_twist);
+	static Ref<IKCompiledRig> compile(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones);
+	// Thread-safe. Returns the cached rig for an identical configuration, compiling and caching it otherwise.
+	static Ref<IKCompiledRig> find_or_compile(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones);
+	// Saves the rig with its tangent handles solved, so loading it needs no geometry work.
+	Error save_to_file(const String &p_path) const;
+	static Ref<IKCompiledRig> load_from_file(const String &p_path, Error *r_error = nullptr);
+	static int32_t get_cache_size();
+	static void clear_cache();
+
+	bool matches(Skeleton3D *p_skeleton, const StringName &p_root_bone, const Vector<StringName> &p_constraint_names, const Vector<Vector2> &p_kusudama_twist, const Vector<bool> &p_kusudama_flip_handedness, const Vector<Vector<Vector4>> &p_kusudama_limit_cones) const;
+	StringName get_root_bone() const;
+	uint32_t get_skeleton_hash() const;
+	uint32_t get_configuration_hash() const;
+	int32_t get_constraint_count() const;
+	const Vector<Constraint> &get_constraints() const;
+
+	IKCompiledRig();
+};
+
+class ResourceFormatLoaderIKCompiledRig : public ResourceFormatLoader {
+public:
+	virtual Ref<Resource> load(const String &p_path, const String &p_original_path = "", Error *r_error = nullptr, bool p_use_sub_threads = false, float *r_progress = nullptr, CacheMode p_cache_mode = CACHE_MODE_REUSE);
+	virtual void get_recognized_extensions(List<String> *p_extensions) const;
+	virtual bool handles_type(const String &p_type) const;
+	virtual String get_resource_type(const String &p_path) const;
+};
+
+class ResourceFormatSaverIKCompiledRig : public ResourceFormatSaver {
+public:
+	virtual Error save(const Ref<Resource> &p_resource, const String &p_path, uint32_t p_flags = 0);
+	virtual void get_recognized_extensions(const Ref<Resource> &p_resource, List<String> *p_extensions) const;
+	virtual bool recognize(const Ref<Resource> &p_resource) const;
+};
+
+#endif // IK_COMPILED_RIG_H
@@ -35,12 +35,18 @@
 void IKEffector3D::set_target_node(Skeleton3D *p_skeleton, const NodePath &p_target_node_path) {
 	ERR_FAIL_NULL(p_skeleton);
 	target_node_path = p_target_node_path;
+	invalidate_target_node_cache();
 }
 
 NodePath IKEffector3D::get_target_node() const {
 	return target_node_path;
 }
 
+void IKEffector3D::invalidate_target_node_cache() {
+	target_node_cache = ObjectID();
+	target_node_cache_valid = false;
+}
+
 void IKEffector3D::set_target_node_rotation(bool p_use) {
 	use_target_node_rotation = p_use;
 }
@@ -61,53 +67,86 @@ void IKEffector3D::update_target_global_transform(Skeleton3D *p_skeleton, EWBIK
 	ERR_FAIL_NULL(p_skeleton);
 	ERR_FAIL_NULL(for_bone);
 	target_global_transform = for_bone->get_ik_transform()->get_global_transform();
-	Node3D *current_target_node = cast_to<Node3D>(p_ewbik->get_node_or_null(target_node_path));
+	if (target_override == TARGET_OVERRIDE_POSITION) {
+		target_global_transform.origin = target_override_transform.origin;
+		return;
+	} else if (target_override == TARGET_OVERRIDE_TRANSFORM) {
+		target_global_transform = target_override_transform;
+		return;
+	}
+	// The path is only resolved again once the cache is invalidated, either by a new path or by the scene tree changing.
+	if (!target_node_cache_valid) {
+		ERR_FAIL_NULL(p_ewbik);
+		Node3D *resolved_node = cast_to<Node3D>(p_ewbik->get_node_or_null(target_node_path));
+		target_node_cache = resolved_node ? resolved_node->get_instance_id() : ObjectID();
+		target_node_cache_valid = true;
+	}
+	if (target_node_cache.is_null()) {
+		return;
+	}
+	Node3D *current_target_node = cast_to<Node3D>(ObjectDB::get_instance(target_node_cache));
 	if (!current_target_node) {
+		invalidate_target_node_cache();
 		return;
 	}
 	Transform3D xform = current_target_node->get_global_transform();
 	target_global_transform = xform;
 }
 
+void IKEffector3D::set_target_override(TargetOverride p_override, const Transform3D &p_global_transform) {
+	target_override = p_override;
+	target_override_transform = p_global_transform;
+}
+
+IKEffector3D::TargetOverride IKEffector3D::get_target_override() const {
+	return target_override;
+}
+
+Transform3D IKEffector3D::transform_from_floats(const float *p_floats) {
+	Transform3D xform;
+	for (int32_t row_i = 0; row_i < 3; row_i++) {
+		const float *row = p_floats + row_i * 4;
+		xform.basis.rows[row_i] = Vector3(row[0], row[1], row[2]);
+		xform.origin[row_i] = row[3];
+	}
+	return xform;
+}
+
+void IKEffector3D::transform_to_floats(const Transform3D &p_transform, float *r_floats) {
+	for (int32_t row_i = 0; row_i < 3; row_i++) {
+		float *row = r_floats + row_i * 4;
+		row[0] = p_transform.basis.rows[row_i].x;
+		row[1] = p_transform.basis.rows[row_i].y;
+		row[2] = p_transform.basis.rows[row_i].z;
+		row[3] = p_transform.origin[row_i];
+	}
+}
+
 Transform3D IKEffector3D::get_target_global_transform() const {
 	return target_global_transform;
 }
 
-void IKEffector3D::create_headings(Vector<real_t> &p_weights) {
-	// int32_t nw = p_weights.size();
-	// int32_t nheadings = nw;
-	// heading_weights.resize(nheadings);
-	// tip_headings.resize(nheadings);
-	// target_headings.resize(nheadings);
-	// for (int32_t i_w = 0; i_w < nw; i_w++) {
-	// 	heading_weights.write[i_w] = p_weights[i_w];
-	// }
-	// int32_t index = 0;
-	// heading_weights.write[nw + index] = weight;
-	// if (get_priority_x_direction() > 0.0) {
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index, heading_weights.size());
-	// 	heading_weights.write[nw + index] = weight;
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index + 1, heading_weights.size());
-	// 	heading_weights.write[nw + index + 1] = weight;
-	// }
-	// if (get_priority_y_direction() > 0.0) {
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index, heading_weights.size());
-	// 	heading_weights.write[nw + index] = weight;
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index + 1, heading_weights.size());
-	// 	heading_weights.write[nw + index + 1] = weight;
-	// }
-	// if (get_priority_z_direction() > 0.0) {
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index, heading_weights.size());
-	// 	heading_weights.write[nw + index] = weight;
-	// 	index++;
-	// 	ERR_FAIL_INDEX(nw + index + 1, heading_weights.size());
-	// 	heading_weights.write[nw + index + 1] = weight;
-	// }
+real_t IKEffector3D::get_weighted_error() const {
+	ERR_FAIL_NULL_V(for_bone, 0.0);
+	const Transform3D tip_xform = for_bone->get_global_pose();
+	const Vector3 origin_offset = target_global_transform.origin - tip_xform.origin;
+	real_t error = origin_offset.length_squared();
+	real_t weight_sum = 1.0;
+	const Vector3 priority = get_direction_priorities();
+	for (int32_t axis_i = Vector3::AXIS_X; axis_i <= Vector3::AXIS_Z; axis_i++) {
+		if (priority[axis_i] <= 0.0) {
+			continue;
+		}
+		const Vector3 axis_offset = target_global_transform.basis.get_column(axis_i) - tip_xform.basis.get_column(axis_i);
+		// The positive and the negative heading along the axis.
+		error += priority[axis_i] * ((origin_offset + axis_offset).length_squared() + (origin_offset - axis_offset).length_squared());
+		weight_sum += priority[axis_i] * 2.0;
+	}
+	return weight * error / weight_sum;
+}
+
+void IKEffector3D::set_target_global_transform(const Transform3D &p_global_transform) {
+	target_global_transform = p_global_transform;
 }
 
 int32_t IKEffector3D::update_effector_target_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone, const Vector<real_t> *p_weights) const {
@@ -193,6 +232,38 @@ int32_t IKEffector3D::update_effector_tip_headings(PackedVector3Array *p_heading
 	return index;
 }
 
+int32_t IKEffector3D::update_effector_heading_weights(Vector<real_t> *r_weights, int32_t p_index, real_t p_falloff) const {
+	ERR_FAIL_COND_V(p_index == -1, -1);
+	ERR_FAIL_NULL_V(r_weights, -1);
+	ERR_FAIL_COND_V(p_index + get_heading_count() > r_weights->size(), -1);
+	int32_t index = p_index;
+	real_t *weights = r_weights->ptrw();
+	weights[index] = weight * p_falloff;
+	index++;
+	const Vector3 priority = get_direction_priorities();
+	for (int32_t axis_i = Vector3::AXIS_X; axis_i <= Vector3::AXIS_Z; axis_i++) {
+		if (priority[axis_i] > 0.0) {
+			real_t sub_target_weight = weight * priority[axis_i] * p_falloff;
+			weights[index] = sub_target_weight;
+			index++;
+			weights[index] = sub_target_weight;
+			index++;
+		}
+	}
+	return index;
+}
+
+int32_t IKEffector3D::get_heading_count() const {
+	int32_t count = 1;
+	const Vector3 priority = get_direction_priorities();
+	for (int32_t axis_i = Vector3::AXIS_X; axis_i <= Vector3::AXIS_Z; axis_i++) {
+		if (priority[axis_i] > 0.0) {
+			count += 2;
+		}
+	}
+	return count;
+}
+
 void IKEffector3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_target_node", "skeleton", "node"),
 			&IKEffector3D::set_target_node);
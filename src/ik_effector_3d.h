@@ -45,21 +45,28 @@ class IKEffector3D : public Resource {
 	friend class IKBone3D;
 	friend class IKBoneSegment;
 
+public:
+	enum TargetOverride {
+		TARGET_OVERRIDE_NONE,
+		TARGET_OVERRIDE_POSITION,
+		TARGET_OVERRIDE_TRANSFORM,
+	};
+
+private:
 	Ref<IKBone3D> for_bone;
 	bool use_target_node_rotation = true;
 	NodePath target_node_path;
 	ObjectID target_node_cache;
+	bool target_node_cache_valid = false;
+	TargetOverride target_override = TARGET_OVERRIDE_NONE;
+	Transform3D target_override_transform;
 	Node *target_node_reference = nullptr;
 
 	Transform3D target_global_transform;
 	int32_t num_headings = 7;
 	real_t weight = 1.0;
 	real_t depth_falloff = 0.0;
-	PackedVector3Array target_headings;
-	PackedVector3Array tip_headings;
-	Vector<real_t> heading_weights;
 	Vector3 direction_priorities = Vector3(0.25, 0, 0.25);
-	void create_headings(Vector<real_t> &p_weights);
 
 protected:
 	static void _bind_methods();
@@ -81,7 +88,19 @@ public:
 	void set_depth_falloff(float p_depth_falloff);
 	void set_target_node(Skeleton3D *p_skeleton, const NodePath &p_target_node_path);
 	NodePath get_target_node() const;
+	void invalidate_target_node_cache();
+	// Drives the target from a global transform instead of the target node, until set back to TARGET_OVERRIDE_NONE.
+	void set_target_override(TargetOverride p_override, const Transform3D &p_global_transform = Transform3D());
+	TargetOverride get_target_override() const;
+	// Reads 12 floats laid out like a MultiMesh buffer: each basis row followed by one origin component.
+	static Transform3D transform_from_floats(const float *p_floats);
+	static void transform_to_floats(const Transform3D &p_transform, float *r_floats);
 	Transform3D get_target_global_transform() const;
+	// Weighted mean squared distance between the tip's and the target's headings, measured from the tip like
+	// IKBoneSegment::get_manual_msd, and scaled by the pin weight.
+	real_t get_weighted_error() const;
+	// Replaces the resolved target until the next update_target_global_transform, e.g. when replaying recorded targets.
+	void set_target_global_transform(const Transform3D &p_global_transform);
 	void set_target_node_rotation(bool p_use);
 	bool get_target_node_rotation() const;
 	Ref<IKBone3D> get_shadow_bone() const;
@@ -89,6 +108,8 @@ public:
 	bool is_following_translation_only() const;
 	int32_t update_effector_target_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone, const Vector<real_t> *p_weights) const;
 	int32_t update_effector_tip_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone) const;
+	int32_t update_effector_heading_weights(Vector<real_t> *r_weights, int32_t p_index, real_t p_falloff) const;
+	int32_t get_heading_count() const;
 	IKEffector3D(const Ref<IKBone3D> &p_current_bone);
 	IKEffector3D() {}
 	~IKEffector3D() {}
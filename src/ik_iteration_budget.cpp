@@ -0,0 +1,147 @@
+/*************************************************************************/
+/*  ik_iteration_budget.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_iteration_budget.h"
+
+#include "core/templates/local_vector.h"
+
+Mutex IKIterationBudget::mutex;
+HashMap<ObjectID, IKIterationBudget::Rig> IKIterationBudget::rigs;
+uint64_t IKIterationBudget::budget_usec = 0;
+uint64_t IKIterationBudget::balanced_frame = 0;
+
+void IKIterationBudget::set_budget_usec(uint64_t p_usec) {
+	MutexLock lock(mutex);
+	budget_usec = p_usec;
+}
+
+uint64_t IKIterationBudget::get_budget_usec() {
+	MutexLock lock(mutex);
+	return budget_usec;
+}
+
+bool IKIterationBudget::is_enabled() {
+	return get_budget_usec() > 0;
+}
+
+int32_t IKIterationBudget::get_iterations(ObjectID p_rig, int32_t p_max_iterations, uint64_t p_frame) {
+	MutexLock lock(mutex);
+	if (p_frame != balanced_frame) {
+		_rebalance(p_frame);
+	}
+	Rig *rig = rigs.getptr(p_rig);
+	if (!rig) {
+		Rig new_rig;
+		new_rig.max_iterations = p_max_iterations;
+		new_rig.iterations = p_max_iterations;
+		new_rig.frame = p_frame;
+		rigs.insert(p_rig, new_rig);
+		return p_max_iterations;
+	}
+	rig->frame = p_frame;
+	rig->max_iterations = p_max_iterations;
+	return CLAMP(rig->iterations, MIN(MIN_ITERATIONS, p_max_iterations), p_max_iterations);
+}
+
+void IKIterationBudget::report(ObjectID p_rig, int32_t p_iterations, uint64_t p_solve_usec, uint64_t p_fixed_usec, real_t p_error) {
+	MutexLock lock(mutex);
+	Rig *rig = rigs.getptr(p_rig);
+	if (!rig || p_iterations <= 0) {
+		return;
+	}
+	const real_t usec_per_iteration = real_t(p_solve_usec) / p_iterations;
+	if (rig->usec_per_iteration > 0.0) {
+		rig->usec_per_iteration = Math::lerp(rig->usec_per_iteration, usec_per_iteration, COST_SMOOTHING);
+		rig->fixed_usec = Math::lerp(rig->fixed_usec, real_t(p_fixed_usec), COST_SMOOTHING);
+	} else {
+		rig->usec_per_iteration = MAX(usec_per_iteration, CMP_EPSILON);
+		rig->fixed_usec = p_fixed_usec;
+	}
+	rig->error = p_error;
+}
+
+void IKIterationBudget::remove(ObjectID p_rig) {
+	MutexLock lock(mutex);
+	rigs.erase(p_rig);
+}
+
+void IKIterationBudget::clear() {
+	MutexLock lock(mutex);
+	rigs.clear();
+	balanced_frame = 0;
+}
+
+void IKIterationBudget::_rebalance(uint64_t p_frame) {
+	balanced_frame = p_frame;
+	// Rigs that did not solve last frame are disabled or gone, and should not hold on to any of the budget.
+	LocalVector<ObjectID> stale_rigs;
+	for (const KeyValue<ObjectID, Rig> &E : rigs) {
+		if (E.value.frame + 1 < p_frame) {
+			stale_rigs.push_back(E.key);
+		}
+	}
+	for (const ObjectID &rig_id : stale_rigs) {
+		rigs.erase(rig_id);
+	}
+
+	LocalVector<Rig *> by_error;
+	real_t remaining_usec = budget_usec;
+	real_t total_error = 0.0;
+	for (KeyValue<ObjectID, Rig> &E : rigs) {
+		Rig &rig = E.value;
+		if (rig.usec_per_iteration <= 0.0) {
+			// Not measured yet.
+			rig.iterations = rig.max_iterations;
+			continue;
+		}
+		rig.iterations = MIN(MIN_ITERATIONS, rig.max_iterations);
+		remaining_usec -= rig.fixed_usec + rig.usec_per_iteration * rig.iterations;
+		total_error += rig.error;
+		by_error.push_back(&rig);
+	}
+	if (remaining_usec <= 0.0) {
+		return;
+	}
+	by_error.sort_custom<ErrorGreater>();
+	// Split what is left in proportion to the residual error, then hand what rounding left over to the worst rigs first.
+	if (total_error > 0.0) {
+		const real_t spare_usec = remaining_usec;
+		for (Rig *rig : by_error) {
+			const int32_t extra = MIN(rig->max_iterations - rig->iterations, int32_t(spare_usec * rig->error / total_error / rig->usec_per_iteration));
+			rig->iterations += extra;
+			remaining_usec -= extra * rig->usec_per_iteration;
+		}
+	}
+	for (Rig *rig : by_error) {
+		const int32_t extra = MIN(rig->max_iterations - rig->iterations, int32_t(remaining_usec / rig->usec_per_iteration));
+		rig->iterations += extra;
+		remaining_usec -= extra * rig->usec_per_iteration;
+	}
+}
@@ -0,0 +1,81 @@
+/*************************************************************************/
+/*  ik_iteration_budget.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_ITERATION_BUDGET_H
+#define IK_ITERATION_BUDGET_H
+
+#include "core/object/object_id.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+
+// Shares a frame time budget between all EWBIK nodes by choosing how many iterations each one solves.
+// Every node reports what its last solve cost and how far its pins ended from their targets. Once per frame the
+// measured costs decide how many iterations fit, and the rigs with the most residual error get the spare ones.
+class IKIterationBudget {
+	struct Rig {
+		real_t usec_per_iteration = 0.0;
+		real_t fixed_usec = 0.0;
+		real_t error = 0.0;
+		int32_t max_iterations = 1;
+		int32_t iterations = 1;
+		uint64_t frame = 0;
+	};
+	struct ErrorGreater {
+		_FORCE_INLINE_ bool operator()(const Rig *p_a, const Rig *p_b) const {
+			return p_a->error > p_b->error;
+		}
+	};
+
+	static Mutex mutex;
+	static HashMap<ObjectID, Rig> rigs;
+	static uint64_t budget_usec;
+	static uint64_t balanced_frame;
+
+	static void _rebalance(uint64_t p_frame);
+
+public:
+	static constexpr int32_t MIN_ITERATIONS = 1;
+	// How much a new measurement moves the cost estimates, to ride out single slow frames.
+	static constexpr real_t COST_SMOOTHING = 0.2;
+
+	// Zero turns the budget off and every node solves its max_ik_iterations.
+	static void set_budget_usec(uint64_t p_usec);
+	static uint64_t get_budget_usec();
+	static bool is_enabled();
+
+	// The iterations p_rig may solve in p_frame, never more than p_max_iterations. The first call of a frame
+	// rebalances the budget. A rig seen for the first time solves p_max_iterations, to measure it.
+	static int32_t get_iterations(ObjectID p_rig, int32_t p_max_iterations, uint64_t p_frame);
+	static void report(ObjectID p_rig, int32_t p_iterations, uint64_t p_solve_usec, uint64_t p_fixed_usec, real_t p_error);
+	static void remove(ObjectID p_rig);
+	static void clear();
+};
+
+#endif // IK_ITERATION_BUDGET_H
@@ -0,0 +1,124 @@
+/*************************************************************************/
+/*  ik_performance.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_performance.h"
+
+#include "core/config/engine.h"
+#include "core/object/callable_method_pointer.h"
+#include "main/performance.h"
+
+thread_local uint64_t IKPerformance::solve_stage_nsec[STAGE_MAX] = {};
+SafeNumeric<uint64_t> IKPerformance::stage_nsec[STAGE_MAX];
+SafeNumeric<uint64_t> IKPerformance::iterations;
+uint64_t IKPerformance::published_stage_nsec[STAGE_MAX] = {};
+uint64_t IKPerformance::published_iterations = 0;
+uint64_t IKPerformance::current_frame = 0;
+bool IKPerformance::monitors_registered = false;
+
+static const char *stage_monitor_names[IKPerformance::STAGE_MAX] = {
+	"EWBIK/gather_ms",
+	"EWBIK/solve_ms",
+	"EWBIK/qcp_ms",
+	"EWBIK/constraints_ms",
+	"EWBIK/write_back_ms",
+};
+
+void IKPerformance::begin_frame() {
+	const uint64_t frame = Engine::get_singleton()->get_process_frames();
+	if (frame == current_frame) {
+		return;
+	}
+	// Subtracting what was read keeps any time added concurrently for the next frame.
+	for (int32_t stage_i = 0; stage_i < STAGE_MAX; stage_i++) {
+		published_stage_nsec[stage_i] = stage_nsec[stage_i].get();
+		stage_nsec[stage_i].sub(published_stage_nsec[stage_i]);
+	}
+	published_iterations = iterations.get();
+	iterations.sub(published_iterations);
+	current_frame = frame;
+	if (!monitors_registered) {
+		register_monitors();
+	}
+}
+
+void IKPerformance::end_solve() {
+	for (int32_t stage_i = 0; stage_i < STAGE_MAX; stage_i++) {
+		if (solve_stage_nsec[stage_i]) {
+			stage_nsec[stage_i].add(solve_stage_nsec[stage_i]);
+			solve_stage_nsec[stage_i] = 0;
+		}
+	}
+}
+
+bool IKPerformance::_is_published_frame_current() {
+	// Totals are published when the next frame's first solve starts, so once no node has solved for a frame they're stale.
+	return Engine::get_singleton()->get_process_frames() - current_frame <= 1;
+}
+
+double IKPerformance::_get_stage_msec(int p_stage) {
+	ERR_FAIL_INDEX_V(p_stage, STAGE_MAX, 0.0);
+	if (!_is_published_frame_current()) {
+		return 0.0;
+	}
+	return published_stage_nsec[p_stage] / 1000000.0;
+}
+
+double IKPerformance::_get_msec_per_iteration() {
+	if (!_is_published_frame_current() || !published_iterations) {
+		return 0.0;
+	}
+	return published_stage_nsec[STAGE_SOLVE] / 1000000.0 / published_iterations;
+}
+
+void IKPerformance::register_monitors() {
+	Performance *performance = Performance::get_singleton();
+	if (monitors_registered || !performance) {
+		return;
+	}
+	for (int32_t stage_i = 0; stage_i < STAGE_MAX; stage_i++) {
+		Vector<Variant> args;
+		args.push_back(stage_i);
+		performance->add_custom_monitor(stage_monitor_names[stage_i], callable_mp_static(&IKPerformance::_get_stage_msec), args);
+	}
+	performance->add_custom_monitor("EWBIK/solve_ms_per_iteration", callable_mp_static(&IKPerformance::_get_msec_per_iteration), Vector<Variant>());
+	monitors_registered = true;
+}
+
+void IKPerformance::unregister_monitors() {
+	Performance *performance = Performance::get_singleton();
+	if (!monitors_registered || !performance) {
+		return;
+	}
+	for (int32_t stage_i = 0; stage_i < STAGE_MAX; stage_i++) {
+		performance->remove_custom_monitor(stage_monitor_names[stage_i]);
+	}
+	performance->remove_custom_monitor("EWBIK/solve_ms_per_iteration");
+	monitors_registered = false;
+}
@@ -0,0 +1,113 @@
+/*************************************************************************/
+/*  ik_performance.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_PERFORMANCE_H
+#define IK_PERFORMANCE_H
+
+#include "core/templates/safe_refcount.h"
+
+#include <chrono>
+
+// Solver time per stage, summed over every EWBIK node and published once per process frame as Performance monitors.
+// The stage scopes compile to nothing unless the module is built with ewbik_performance_monitors=yes.
+class IKPerformance {
+public:
+	enum Stage {
+		STAGE_GATHER,
+		STAGE_SOLVE,
+		STAGE_QCP,
+		STAGE_CONSTRAINTS,
+		STAGE_WRITE_BACK,
+		STAGE_MAX
+	};
+
+	// QCP and constraint scopes wrap a single bone and often take less than a microsecond, so they're timed in nanoseconds.
+	static _FORCE_INLINE_ uint64_t get_ticks_nsec() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	class Scope {
+		Stage stage;
+		uint64_t start_nsec;
+
+	public:
+		_FORCE_INLINE_ Scope(Stage p_stage) :
+				stage(p_stage), start_nsec(get_ticks_nsec()) {}
+		_FORCE_INLINE_ ~Scope() {
+			solve_stage_nsec[stage] += get_ticks_nsec() - start_nsec;
+		}
+	};
+
+	// Wraps one node's update. Its stages add up on the solving thread and are published to the totals when it ends.
+	class SolveScope {
+	public:
+		SolveScope() {
+			begin_frame();
+		}
+		~SolveScope() {
+			end_solve();
+		}
+	};
+
+private:
+	static thread_local uint64_t solve_stage_nsec[STAGE_MAX];
+	static SafeNumeric<uint64_t> stage_nsec[STAGE_MAX];
+	static SafeNumeric<uint64_t> iterations;
+	static uint64_t published_stage_nsec[STAGE_MAX];
+	static uint64_t published_iterations;
+	static uint64_t current_frame;
+	static bool monitors_registered;
+
+	static bool _is_published_frame_current();
+	static double _get_stage_msec(int p_stage);
+	static double _get_msec_per_iteration();
+
+public:
+	// Publishes the previous frame's totals the first time it's called in a new process frame.
+	static void begin_frame();
+	static void end_solve();
+	static void add_iterations(int32_t p_iterations) {
+		iterations.add(p_iterations);
+	}
+	static void register_monitors();
+	static void unregister_monitors();
+};
+
+#ifdef EWBIK_PERFORMANCE_MONITORS
+#define IK_PERFORMANCE_STAGE(m_stage) IKPerformance::Scope _ik_performance_stage(IKPerformance::m_stage)
+#define IK_PERFORMANCE_SOLVE() IKPerformance::SolveScope _ik_performance_solve
+#define IK_PERFORMANCE_ADD_ITERATIONS(m_iterations) IKPerformance::add_iterations(m_iterations)
+#else
+#define IK_PERFORMANCE_STAGE(m_stage)
+#define IK_PERFORMANCE_SOLVE()
+#define IK_PERFORMANCE_ADD_ITERATIONS(m_iterations)
+#endif
+
+#endif // IK_PERFORMANCE_H
@@ -0,0 +1,101 @@
+/*************************************************************************/
+/*  ik_profiler.cpp                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_profiler.h"
+
+#include "core/os/thread.h"
+
+IKProfilerBackend *IKProfiler::backend = nullptr;
+IKChromeTraceProfilerBackend IKProfiler::chrome_trace_backend;
+
+Error IKChromeTraceProfilerBackend::open(const String &p_path) {
+	MutexLock lock(mutex);
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot write the IK profiler trace '" + p_path + "'.");
+	file->store_string("[\n");
+	first_event = true;
+	return OK;
+}
+
+void IKChromeTraceProfilerBackend::close() {
+	MutexLock lock(mutex);
+	if (file.is_null()) {
+		return;
+	}
+	file->store_string("\n]\n");
+	file.unref();
+}
+
+bool IKChromeTraceProfilerBackend::is_open() const {
+	return file.is_valid();
+}
+
+void IKChromeTraceProfilerBackend::_store_event(const String &p_event) {
+	MutexLock lock(mutex);
+	// Zones still open when the trace stops end after the file is closed.
+	if (file.is_null()) {
+		return;
+	}
+	file->store_string(first_event ? p_event : ",\n" + p_event);
+	first_event = false;
+}
+
+void IKChromeTraceProfilerBackend::begin_zone(const char *p_name, const String &p_detail, uint64_t p_usec) {
+	String event = vformat("{\"name\":\"%s\",\"cat\":\"ewbik\",\"ph\":\"B\",\"ts\":%d,\"pid\":0,\"tid\":%d", p_name, p_usec, Thread::get_caller_id());
+	if (!p_detail.is_empty()) {
+		event += ",\"args\":{\"detail\":\"" + p_detail.json_escape() + "\"}";
+	}
+	_store_event(event + "}");
+}
+
+void IKChromeTraceProfilerBackend::end_zone(const char *p_name, uint64_t p_usec) {
+	_store_event(vformat("{\"name\":\"%s\",\"cat\":\"ewbik\",\"ph\":\"E\",\"ts\":%d,\"pid\":0,\"tid\":%d}", p_name, p_usec, Thread::get_caller_id()));
+}
+
+Error IKProfiler::start_chrome_trace(const String &p_path) {
+#ifdef EWBIK_PROFILER_ZONES
+	stop_chrome_trace();
+	Error err = chrome_trace_backend.open(p_path);
+	if (err == OK) {
+		set_backend(&chrome_trace_backend);
+	}
+	return err;
+#else
+	ERR_FAIL_V_MSG(ERR_UNAVAILABLE, "The IK profiler zones are compiled out. Build with ewbik_profiler_zones=yes to capture a trace.");
+#endif
+}
+
+void IKProfiler::stop_chrome_trace() {
+	if (backend == &chrome_trace_backend) {
+		set_backend(nullptr);
+	}
+	chrome_trace_backend.close();
+}
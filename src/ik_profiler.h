@@ -0,0 +1,106 @@
+/*************************************************************************/
+/*  ik_profiler.h                                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_PROFILER_H
+#define IK_PROFILER_H
+
+#include "core/io/file_access.h"
+#include "core/os/mutex.h"
+#include "core/os/os.h"
+#include "core/string/ustring.h"
+
+// Receives the solver's profiler zones. Zones can open on several threads at once, so backends must be thread safe.
+class IKProfilerBackend {
+public:
+	virtual void begin_zone(const char *p_name, const String &p_detail, uint64_t p_usec) = 0;
+	virtual void end_zone(const char *p_name, uint64_t p_usec) = 0;
+	virtual ~IKProfilerBackend() {}
+};
+
+// Writes the zones as Chrome trace events, which chrome://tracing and Perfetto open directly.
+class IKChromeTraceProfilerBackend : public IKProfilerBackend {
+	Mutex mutex;
+	Ref<FileAccess> file;
+	bool first_event = true;
+
+	void _store_event(const String &p_event);
+
+public:
+	Error open(const String &p_path);
+	void close();
+	bool is_open() const;
+	virtual void begin_zone(const char *p_name, const String &p_detail, uint64_t p_usec) override;
+	virtual void end_zone(const char *p_name, uint64_t p_usec) override;
+};
+
+class IKProfiler {
+	static IKProfilerBackend *backend;
+	static IKChromeTraceProfilerBackend chrome_trace_backend;
+
+public:
+	class Zone {
+		IKProfilerBackend *zone_backend;
+		const char *name;
+
+	public:
+		_FORCE_INLINE_ Zone(const char *p_name, const String &p_detail = String()) :
+				zone_backend(backend), name(p_name) {
+			if (zone_backend) {
+				zone_backend->begin_zone(name, p_detail, OS::get_singleton()->get_ticks_usec());
+			}
+		}
+		_FORCE_INLINE_ ~Zone() {
+			if (zone_backend) {
+				zone_backend->end_zone(name, OS::get_singleton()->get_ticks_usec());
+			}
+		}
+	};
+
+	// The backend isn't owned and must outlive every zone opened while it was set.
+	static void set_backend(IKProfilerBackend *p_backend) {
+		backend = p_backend;
+	}
+	static IKProfilerBackend *get_backend() {
+		return backend;
+	}
+	static Error start_chrome_trace(const String &p_path);
+	static void stop_chrome_trace();
+};
+
+#ifdef EWBIK_PROFILER_ZONES
+#define IK_PROFILE_ZONE(m_name) IKProfiler::Zone _ik_profile_zone(m_name)
+// The detail string is only built while a backend is listening.
+#define IK_PROFILE_ZONE_DETAIL(m_name, m_detail) IKProfiler::Zone _ik_profile_zone(m_name, IKProfiler::get_backend() ? String(m_detail) : String())
+#else
+#define IK_PROFILE_ZONE(m_name)
+#define IK_PROFILE_ZONE_DETAIL(m_name, m_detail)
+#endif
+
+#endif // IK_PROFILER_H
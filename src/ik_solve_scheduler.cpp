@@ -0,0 +1,85 @@
+/*************************************************************************/
+/*  ik_solve_scheduler.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_solve_scheduler.h"
+
+#include "core/templates/local_vector.h"
+
+Mutex IKSolveScheduler::mutex;
+HashMap<ObjectID, IKSolveScheduler::Slot> IKSolveScheduler::slots;
+
+int32_t IKSolveScheduler::_find_lightest_phase(int32_t p_interval) {
+	// The cost landing on each of the next p_interval frames. Exact when the intervals divide each other, which the
+	// usual choices of 2, 4 or 8 frames do.
+	LocalVector<uint64_t> frame_costs;
+	frame_costs.resize(p_interval);
+	for (int32_t frame_i = 0; frame_i < p_interval; frame_i++) {
+		frame_costs[frame_i] = 0;
+		for (const KeyValue<ObjectID, Slot> &E : slots) {
+			if (frame_i % E.value.interval == E.value.phase) {
+				frame_costs[frame_i] += E.value.cost;
+			}
+		}
+	}
+	int32_t lightest_phase = 0;
+	for (int32_t frame_i = 1; frame_i < p_interval; frame_i++) {
+		if (frame_costs[frame_i] < frame_costs[lightest_phase]) {
+			lightest_phase = frame_i;
+		}
+	}
+	return lightest_phase;
+}
+
+bool IKSolveScheduler::is_due(ObjectID p_rig, int32_t p_interval, uint64_t p_cost, uint64_t p_frame) {
+	if (p_interval <= 1) {
+		return true;
+	}
+	MutexLock lock(mutex);
+	Slot *slot = slots.getptr(p_rig);
+	if (!slot || slot->interval != p_interval) {
+		slots.erase(p_rig);
+		Slot new_slot;
+		new_slot.interval = p_interval;
+		new_slot.phase = _find_lightest_phase(p_interval);
+		slot = &slots.insert(p_rig, new_slot)->value;
+	}
+	slot->cost = p_cost;
+	return int32_t(p_frame % p_interval) == slot->phase;
+}
+
+void IKSolveScheduler::remove(ObjectID p_rig) {
+	MutexLock lock(mutex);
+	slots.erase(p_rig);
+}
+
+void IKSolveScheduler::clear() {
+	MutexLock lock(mutex);
+	slots.clear();
+}
@@ -0,0 +1,60 @@
+/*************************************************************************/
+/*  ik_solve_scheduler.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_SOLVE_SCHEDULER_H
+#define IK_SOLVE_SCHEDULER_H
+
+#include "core/object/object_id.h"
+#include "core/os/mutex.h"
+#include "core/templates/hash_map.h"
+
+// Staggers EWBIK nodes that solve once every few frames, so a crowd doesn't land all its solves on the same frame.
+// Each rig gets a phase when it first asks, the one whose frames carry the least cost so far, and keeps it until its
+// interval changes.
+class IKSolveScheduler {
+	struct Slot {
+		int32_t interval = 1;
+		int32_t phase = 0;
+		uint64_t cost = 0;
+	};
+
+	static Mutex mutex;
+	static HashMap<ObjectID, Slot> slots;
+
+	static int32_t _find_lightest_phase(int32_t p_interval);
+
+public:
+	// Whether p_rig, solving every p_interval frames at roughly p_cost, should solve in p_frame.
+	static bool is_due(ObjectID p_rig, int32_t p_interval, uint64_t p_cost, uint64_t p_frame);
+	static void remove(ObjectID p_rig);
+	static void clear();
+};
+
+#endif // IK_SOLVE_SCHEDULER_H
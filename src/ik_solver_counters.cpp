@@ -0,0 +1,76 @@
+/*************************************************************************/
+/*  ik_solver_counters.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_solver_counters.h"
+
+Mutex IKSolverCounters::global_mutex;
+IKSolverCounters IKSolverCounters::global;
+thread_local IKSolverCounters *IKSolverCounters::current = nullptr;
+
+void IKSolverCounters::add(const IKSolverCounters &p_counters) {
+	solves += p_counters.solves;
+	early_exits += p_counters.early_exits;
+	bones_solved += p_counters.bones_solved;
+	qcp_calls += p_counters.qcp_calls;
+	qcp_headings += p_counters.qcp_headings;
+	orientation_snaps += p_counters.orientation_snaps;
+	twist_snaps += p_counters.twist_snaps;
+	converged_segments += p_counters.converged_segments;
+	rebuilds += p_counters.rebuilds;
+}
+
+Dictionary IKSolverCounters::to_dictionary() const {
+	Dictionary stats;
+	stats["solves"] = solves;
+	stats["early_exits"] = early_exits;
+	stats["bones_solved"] = bones_solved;
+	stats["qcp_calls"] = qcp_calls;
+	stats["qcp_headings"] = qcp_headings;
+	stats["orientation_snaps"] = orientation_snaps;
+	stats["twist_snaps"] = twist_snaps;
+	stats["converged_segments"] = converged_segments;
+	stats["rebuilds"] = rebuilds;
+	return stats;
+}
+
+void IKSolverCounters::add_to_global(const IKSolverCounters &p_counters) {
+	MutexLock lock(global_mutex);
+	global.add(p_counters);
+}
+
+Dictionary IKSolverCounters::get_global_dictionary() {
+	MutexLock lock(global_mutex);
+	return global.to_dictionary();
+}
+
+void IKSolverCounters::reset_global() {
+	MutexLock lock(global_mutex);
+	global = IKSolverCounters();
+}
@@ -0,0 +1,70 @@
+/*************************************************************************/
+/*  ik_solver_counters.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_SOLVER_COUNTERS_H
+#define IK_SOLVER_COUNTERS_H
+
+#include "core/os/mutex.h"
+#include "core/variant/dictionary.h"
+
+// Integer tallies of the work done by the solver, kept per EWBIK node and summed over all of them.
+class IKSolverCounters {
+	static Mutex global_mutex;
+	static IKSolverCounters global;
+
+public:
+	uint64_t solves = 0;
+	uint64_t early_exits = 0;
+	uint64_t bones_solved = 0;
+	uint64_t qcp_calls = 0;
+	uint64_t qcp_headings = 0;
+	uint64_t orientation_snaps = 0;
+	uint64_t twist_snaps = 0;
+	uint64_t converged_segments = 0;
+	uint64_t rebuilds = 0;
+
+	// The counters of the solve running on this thread, if any. The segments and constraints count into it.
+	static thread_local IKSolverCounters *current;
+
+	void add(const IKSolverCounters &p_counters);
+	Dictionary to_dictionary() const;
+
+	static void add_to_global(const IKSolverCounters &p_counters);
+	static Dictionary get_global_dictionary();
+	static void reset_global();
+};
+
+#define IK_COUNT(m_counter, m_amount)                       \
+	if (IKSolverCounters::current) {                        \
+		IKSolverCounters::current->m_counter += (m_amount); \
+	} else                                                  \
+		((void)0)
+
+#endif // IK_SOLVER_COUNTERS_H
@@ -0,0 +1,166 @@
+/*************************************************************************/
+/*  ik_target_recording.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_target_recording.h"
+
+#include "core/io/marshalls.h"
+#include "ik_effector_3d.h"
+
+// The skeleton transform, then a transform for each bone and effector.
+static uint64_t _get_transforms_size(int32_t p_bone_count, int32_t p_effector_count) {
+	return (1 + uint64_t(p_bone_count) + uint64_t(p_effector_count)) * 12 * sizeof(float);
+}
+
+static void _encode_transform(const Transform3D &p_transform, uint8_t *r_bytes) {
+	float floats[12];
+	IKEffector3D::transform_to_floats(p_transform, floats);
+	for (int32_t float_i = 0; float_i < 12; float_i++) {
+		encode_float(floats[float_i], r_bytes + float_i * sizeof(float));
+	}
+}
+
+static Transform3D _decode_transform(const uint8_t *p_bytes) {
+	float floats[12];
+	for (int32_t float_i = 0; float_i < 12; float_i++) {
+		floats[float_i] = decode_float(p_bytes + float_i * sizeof(float));
+	}
+	return IKEffector3D::transform_from_floats(floats);
+}
+
+Error IKTargetRecording::begin_write(const String &p_path, uint32_t p_skeleton_hash, int32_t p_bone_count, int32_t p_effector_count) {
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot write IK recording '" + p_path + "'.");
+	skeleton_hash = p_skeleton_hash;
+	bone_count = p_bone_count;
+	effector_count = p_effector_count;
+	frame_buffer.resize(_get_transforms_size(bone_count, effector_count));
+	file->store_buffer((const uint8_t *)"EWRC", 4);
+	file->store_32(FORMAT_VERSION);
+	file->store_32(skeleton_hash);
+	file->store_32(bone_count);
+	file->store_32(effector_count);
+	return OK;
+}
+
+void IKTargetRecording::write_frame(double p_delta, const FrameSolve &p_solve, const Transform3D &p_root_parent, const Transform3D *p_input_poses, const Transform3D *p_targets) {
+	ERR_FAIL_COND(file.is_null());
+	// Encoded little-endian like the rest of the file, so recordings replay on any host.
+	uint8_t *bytes = frame_buffer.ptrw();
+	const uint64_t transform_size = 12 * sizeof(float);
+	_encode_transform(p_root_parent, bytes);
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		_encode_transform(p_input_poses[bone_i], bytes + (1 + bone_i) * transform_size);
+	}
+	for (int32_t effector_i = 0; effector_i < effector_count; effector_i++) {
+		_encode_transform(p_targets[effector_i], bytes + (1 + bone_count + effector_i) * transform_size);
+	}
+	file->store_double(p_delta);
+	file->store_32(p_solve.iterations);
+	file->store_32(p_solve.schedule_start);
+	file->store_32(p_solve.schedule_iterations);
+	file->store_buffer(bytes, frame_buffer.size());
+}
+
+Error IKTargetRecording::open(const String &p_path) {
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot open IK recording '" + p_path + "'.");
+	uint8_t magic[4];
+	file->get_buffer(magic, 4);
+	if (magic[0] != 'E' || magic[1] != 'W' || magic[2] != 'R' || magic[3] != 'C') {
+		close();
+		ERR_FAIL_V_MSG(ERR_FILE_UNRECOGNIZED, "'" + p_path + "' is not an IK recording.");
+	}
+	const uint32_t version = file->get_32();
+	if (version != FORMAT_VERSION) {
+		close();
+		ERR_FAIL_V_MSG(ERR_FILE_UNRECOGNIZED, vformat("IK recording '%s' has format version %d, expected %d.", p_path, version, FORMAT_VERSION));
+	}
+	skeleton_hash = file->get_32();
+	const int32_t header_bone_count = int32_t(file->get_32());
+	const int32_t header_effector_count = int32_t(file->get_32());
+	// Checked against the file's length before sizing anything from them. A recording without any frame is fine.
+	const uint64_t remaining = file->get_length() - file->get_position();
+	const uint64_t frame_size = FRAME_HEADER_SIZE + _get_transforms_size(MAX(header_bone_count, 0), MAX(header_effector_count, 0));
+	if (file->eof_reached() || header_bone_count < 0 || header_effector_count < 0 || (remaining && remaining < frame_size)) {
+		close();
+		ERR_FAIL_V_MSG(ERR_FILE_CORRUPT, "IK recording '" + p_path + "' is corrupt.");
+	}
+	bone_count = header_bone_count;
+	effector_count = header_effector_count;
+	frame_buffer.resize(remaining ? frame_size - FRAME_HEADER_SIZE : 0);
+	return OK;
+}
+
+bool IKTargetRecording::read_frame(double &r_delta, FrameSolve &r_solve, Transform3D &r_root_parent, Transform3D *r_input_poses, Transform3D *r_targets) {
+	ERR_FAIL_COND_V(file.is_null(), false);
+	const double delta = file->get_double();
+	FrameSolve solve;
+	solve.iterations = int32_t(file->get_32());
+	solve.schedule_start = int32_t(file->get_32());
+	solve.schedule_iterations = int32_t(file->get_32());
+	const uint64_t size = frame_buffer.size();
+	if (!size || file->get_buffer(frame_buffer.ptrw(), size) != size) {
+		return false;
+	}
+	r_delta = delta;
+	r_solve = solve;
+	const uint8_t *bytes = frame_buffer.ptr();
+	const uint64_t transform_size = 12 * sizeof(float);
+	r_root_parent = _decode_transform(bytes);
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		r_input_poses[bone_i] = _decode_transform(bytes + (1 + bone_i) * transform_size);
+	}
+	for (int32_t effector_i = 0; effector_i < effector_count; effector_i++) {
+		r_targets[effector_i] = _decode_transform(bytes + (1 + bone_count + effector_i) * transform_size);
+	}
+	return true;
+}
+
+void IKTargetRecording::close() {
+	file.unref();
+}
+
+bool IKTargetRecording::is_open() const {
+	return file.is_valid();
+}
+
+uint32_t IKTargetRecording::get_skeleton_hash() const {
+	return skeleton_hash;
+}
+
+int32_t IKTargetRecording::get_bone_count() const {
+	return bone_count;
+}
+
+int32_t IKTargetRecording::get_effector_count() const {
+	return effector_count;
+}
@@ -0,0 +1,74 @@
+/*************************************************************************/
+/*  ik_target_recording.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_TARGET_RECORDING_H
+#define IK_TARGET_RECORDING_H
+
+#include "core/io/file_access.h"
+#include "core/math/transform_3d.h"
+#include "core/templates/vector.h"
+
+// Reads and writes the per-frame solver inputs of an EWBIK node: how many iterations it ran, the skeleton's global
+// transform, the shadow bones' starting poses and the effector targets, the last two in bone list order, so a capture
+// can re-drive the solver without a scene.
+class IKTargetRecording {
+	Ref<FileAccess> file;
+	uint32_t skeleton_hash = 0;
+	int32_t bone_count = 0;
+	int32_t effector_count = 0;
+	Vector<uint8_t> frame_buffer;
+
+public:
+	static const uint32_t FORMAT_VERSION = 2;
+	// The delta and the FrameSolve that start every frame.
+	static const uint64_t FRAME_HEADER_SIZE = 8 + 3 * 4;
+
+	// The iterations a frame was allowed and where they fall in the damp schedule, which spans several frames when
+	// the solve is amortized.
+	struct FrameSolve {
+		int32_t iterations = 0;
+		int32_t schedule_start = 0;
+		int32_t schedule_iterations = 0;
+	};
+
+	Error begin_write(const String &p_path, uint32_t p_skeleton_hash, int32_t p_bone_count, int32_t p_effector_count);
+	void write_frame(double p_delta, const FrameSolve &p_solve, const Transform3D &p_root_parent, const Transform3D *p_input_poses, const Transform3D *p_targets);
+	Error open(const String &p_path);
+	// Returns false at the end of the recording.
+	bool read_frame(double &r_delta, FrameSolve &r_solve, Transform3D &r_root_parent, Transform3D *r_input_poses, Transform3D *r_targets);
+	void close();
+	bool is_open() const;
+
+	uint32_t get_skeleton_hash() const;
+	int32_t get_bone_count() const;
+	int32_t get_effector_count() const;
+};
+
+#endif // IK_TARGET_RECORDING_H
@@ -0,0 +1,306 @@
+/*************************************************************************/
+/*  ik_target_stream.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_target_stream.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/marshalls.h"
+#include "core/os/os.h"
+#include "ik_effector_3d.h"
+
+#ifdef UNIX_ENABLED
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void IKTargetStream::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("open", "path"), &IKTargetStream::open);
+	ClassDB::bind_static_method("IKTargetStream", D_METHOD("save_frames", "path", "pin_count", "timestamps", "transforms"), &IKTargetStream::save_frames);
+	ClassDB::bind_method(D_METHOD("start"), &IKTargetStream::start);
+	ClassDB::bind_method(D_METHOD("stop"), &IKTargetStream::stop);
+	ClassDB::bind_method(D_METHOD("is_running"), &IKTargetStream::is_running);
+	ClassDB::bind_method(D_METHOD("get_pin_count"), &IKTargetStream::get_pin_count);
+	ClassDB::bind_method(D_METHOD("get_dropped_frame_count"), &IKTargetStream::get_dropped_frame_count);
+	ClassDB::bind_method(D_METHOD("set_loop", "loop"), &IKTargetStream::set_loop);
+	ClassDB::bind_method(D_METHOD("get_loop"), &IKTargetStream::get_loop);
+	ClassDB::bind_method(D_METHOD("set_paced", "paced"), &IKTargetStream::set_paced);
+	ClassDB::bind_method(D_METHOD("is_paced"), &IKTargetStream::is_paced);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "loop"), "set_loop", "get_loop");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "paced"), "set_paced", "is_paced");
+}
+
+Error IKTargetStream::_open_source(const String &p_path) {
+	_close_source();
+#ifdef UNIX_ENABLED
+	const CharString global_path = ProjectSettings::get_singleton()->globalize_path(p_path).utf8();
+	struct stat path_stat;
+	if (stat(global_path.get_data(), &path_stat) == 0 && S_ISFIFO(path_stat.st_mode)) {
+		// Blocks until a writer opens the pipe, like opening it as a file would. Reads after that never block.
+		pipe_fd = ::open(global_path.get_data(), O_RDONLY);
+		ERR_FAIL_COND_V_MSG(pipe_fd == -1, ERR_CANT_OPEN, "Cannot open IK target stream '" + p_path + "'.");
+		fcntl(pipe_fd, F_SETFL, fcntl(pipe_fd, F_GETFL) | O_NONBLOCK);
+		return OK;
+	}
+#endif
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot open IK target stream '" + p_path + "'.");
+	return OK;
+}
+
+void IKTargetStream::_close_source() {
+	file.unref();
+#ifdef UNIX_ENABLED
+	if (pipe_fd != -1) {
+		::close(pipe_fd);
+		pipe_fd = -1;
+	}
+#endif
+}
+
+bool IKTargetStream::_read_bytes(uint8_t *r_buffer, int64_t p_size) {
+	if (file.is_valid()) {
+		return file->get_buffer(r_buffer, p_size) == uint64_t(p_size);
+	}
+#ifdef UNIX_ENABLED
+	int64_t read_size = 0;
+	while (read_size < p_size) {
+		const ssize_t result = ::read(pipe_fd, r_buffer + read_size, p_size - read_size);
+		if (result > 0) {
+			read_size += result;
+			continue;
+		}
+		if (result == 0) {
+			// Every writer closed the pipe.
+			return false;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			return false;
+		}
+		if (exit_thread.is_set()) {
+			return false;
+		}
+		// Wake up now and then to notice stop() while the writer is idle.
+		struct pollfd poll_fd = { pipe_fd, POLLIN, 0 };
+		poll(&poll_fd, 1, 10);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+Error IKTargetStream::open(const String &p_path) {
+	ERR_FAIL_COND_V_MSG(is_running(), ERR_ALREADY_IN_USE, "Stop the target stream before opening another file.");
+	stop();
+	exit_thread.clear();
+	const Error err = _open_source(p_path);
+	if (err != OK) {
+		return err;
+	}
+	uint8_t header[12];
+	ERR_FAIL_COND_V_MSG(!_read_bytes(header, 12), ERR_FILE_CORRUPT, "IK target stream '" + p_path + "' ends before its header.");
+	ERR_FAIL_COND_V_MSG(header[0] != 'E' || header[1] != 'W' || header[2] != 'T' || header[3] != 'S', ERR_FILE_UNRECOGNIZED, "'" + p_path + "' is not an IK target stream.");
+	const uint32_t version = decode_uint32(header + 4);
+	ERR_FAIL_COND_V_MSG(version != FORMAT_VERSION, ERR_FILE_UNRECOGNIZED, vformat("IK target stream '%s' has format version %d, expected %d.", p_path, version, FORMAT_VERSION));
+	const int32_t header_pin_count = int32_t(decode_uint32(header + 8));
+	ERR_FAIL_COND_V_MSG(header_pin_count < 0 || header_pin_count > MAX_PIN_COUNT, ERR_FILE_CORRUPT, vformat("IK target stream '%s' claims %d pins, expected at most %d.", p_path, header_pin_count, MAX_PIN_COUNT));
+	pin_count = header_pin_count;
+	frames_offset = 4 + 4 + 4;
+	frames_read = false;
+	// A timestamp, then 12 floats for each pin.
+	frame_buffer.resize(8 + pin_count * 12 * 4);
+	for (Frame &frame : ring) {
+		frame.targets.resize(pin_count);
+	}
+	overflow_frame.targets.resize(pin_count);
+	return OK;
+}
+
+Error IKTargetStream::save_frames(const String &p_path, int32_t p_pin_count, const PackedFloat64Array &p_timestamps, const PackedFloat32Array &p_transforms) {
+	ERR_FAIL_COND_V(p_pin_count < 0, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V_MSG(p_transforms.size() != p_timestamps.size() * p_pin_count * 12, ERR_INVALID_PARAMETER, "Expected 12 floats for each pin of each frame.");
+	Error err;
+	Ref<FileAccess> out = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot save IK target stream '" + p_path + "'.");
+	out->store_buffer((const uint8_t *)"EWTS", 4);
+	out->store_32(FORMAT_VERSION);
+	out->store_32(p_pin_count);
+	const float *transforms = p_transforms.ptr();
+	for (int32_t frame_i = 0; frame_i < p_timestamps.size(); frame_i++) {
+		out->store_double(p_timestamps[frame_i]);
+		for (int32_t float_i = 0; float_i < p_pin_count * 12; float_i++) {
+			out->store_float(transforms[frame_i * p_pin_count * 12 + float_i]);
+		}
+	}
+	return OK;
+}
+
+bool IKTargetStream::_read_frame(Frame &r_frame) {
+	if (!_read_bytes(frame_buffer.ptrw(), frame_buffer.size())) {
+		return false;
+	}
+	const uint8_t *bytes = frame_buffer.ptr();
+	r_frame.timestamp = decode_double(bytes);
+	float floats[12];
+	Transform3D *targets = r_frame.targets.ptrw();
+	for (int32_t pin_i = 0; pin_i < pin_count; pin_i++) {
+		for (int32_t float_i = 0; float_i < 12; float_i++) {
+			floats[float_i] = decode_float(bytes + 8 + (pin_i * 12 + float_i) * 4);
+		}
+		targets[pin_i] = IKEffector3D::transform_from_floats(floats);
+	}
+	return true;
+}
+
+void IKTargetStream::_thread_func(void *p_userdata) {
+	IKTargetStream *stream = static_cast<IKTargetStream *>(p_userdata);
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+	double first_timestamp = -1.0;
+	bool has_read_frame = false;
+	while (!stream->exit_thread.is_set()) {
+		const uint32_t write = stream->write_index.get();
+		// The consumer only wants the newest frame, so a full ring means it stopped consuming; drop frames instead of waiting.
+		const bool is_full = write - stream->read_index.get() >= RING_CAPACITY;
+		Frame &frame = is_full ? stream->overflow_frame : stream->ring[write % RING_CAPACITY];
+		if (!stream->_read_frame(frame)) {
+			if (!stream->loop || !has_read_frame || stream->file.is_null()) {
+				break;
+			}
+			has_read_frame = false;
+			stream->file->seek(stream->frames_offset);
+			start_usec = OS::get_singleton()->get_ticks_usec();
+			first_timestamp = -1.0;
+			continue;
+		}
+		has_read_frame = true;
+		stream->frames_read = true;
+		if (is_full) {
+			stream->dropped_frame_count.increment();
+			continue;
+		}
+		if (stream->paced) {
+			if (first_timestamp < 0.0) {
+				first_timestamp = frame.timestamp;
+			}
+			const uint64_t due_usec = start_usec + uint64_t(MAX(frame.timestamp - first_timestamp, 0.0) * 1000000.0);
+			uint64_t now_usec = OS::get_singleton()->get_ticks_usec();
+			while (now_usec < due_usec && !stream->exit_thread.is_set()) {
+				OS::get_singleton()->delay_usec(MIN(due_usec - now_usec, uint64_t(1000)));
+				now_usec = OS::get_singleton()->get_ticks_usec();
+			}
+		}
+		stream->write_index.set(write + 1);
+	}
+	stream->running.clear();
+}
+
+Error IKTargetStream::start() {
+	ERR_FAIL_COND_V_MSG(file.is_null() && pipe_fd == -1, ERR_UNCONFIGURED, "Open a target stream before starting it.");
+	stop();
+	if (frames_read && file.is_valid()) {
+		file->seek(frames_offset);
+		frames_read = false;
+	}
+	exit_thread.clear();
+	running.set();
+	thread.start(&IKTargetStream::_thread_func, this);
+	return OK;
+}
+
+void IKTargetStream::stop() {
+	if (!thread.is_started()) {
+		return;
+	}
+	exit_thread.set();
+	thread.wait_to_finish();
+	running.clear();
+}
+
+bool IKTargetStream::is_running() const {
+	return running.is_set();
+}
+
+int32_t IKTargetStream::get_pin_count() const {
+	return pin_count;
+}
+
+uint64_t IKTargetStream::get_dropped_frame_count() const {
+	return dropped_frame_count.get();
+}
+
+void IKTargetStream::set_loop(bool p_loop) {
+	loop = p_loop;
+}
+
+bool IKTargetStream::get_loop() const {
+	return loop;
+}
+
+void IKTargetStream::set_paced(bool p_paced) {
+	paced = p_paced;
+}
+
+bool IKTargetStream::is_paced() const {
+	return paced;
+}
+
+bool IKTargetStream::pop_latest(Vector<Transform3D> &r_targets, double *r_timestamp) {
+	const uint32_t write = write_index.get();
+	const uint32_t read = read_index.get();
+	if (read == write) {
+		return false;
+	}
+	// The producer never writes more than RING_CAPACITY frames past read_index, so this slot stays untouched until read_index moves.
+	const Frame &frame = ring[(write - 1) % RING_CAPACITY];
+	r_targets.resize(frame.targets.size());
+	const Transform3D *source = frame.targets.ptr();
+	Transform3D *destination = r_targets.ptrw();
+	for (int32_t pin_i = 0; pin_i < frame.targets.size(); pin_i++) {
+		destination[pin_i] = source[pin_i];
+	}
+	if (r_timestamp) {
+		*r_timestamp = frame.timestamp;
+	}
+	read_index.set(write);
+	return true;
+}
+
+IKTargetStream::IKTargetStream() {
+}
+
+IKTargetStream::~IKTargetStream() {
+	stop();
+	_close_source();
+}
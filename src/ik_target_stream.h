@@ -0,0 +1,109 @@
+/*************************************************************************/
+/*  ik_target_stream.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_TARGET_STREAM_H
+#define IK_TARGET_STREAM_H
+
+#include "core/io/file_access.h"
+#include "core/object/ref_counted.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+
+// Feeds pin targets from timestamped frames read on a worker thread.
+// The worker is the only producer and the solving thread the only consumer of a lock-free ring of frames,
+// so neither side ever waits for the other.
+class IKTargetStream : public RefCounted {
+	GDCLASS(IKTargetStream, RefCounted);
+
+public:
+	static const uint32_t FORMAT_VERSION = 1;
+	static const uint32_t RING_CAPACITY = 16;
+	static const int32_t MAX_PIN_COUNT = 4096;
+
+private:
+	struct Frame {
+		double timestamp = 0.0;
+		Vector<Transform3D> targets;
+	};
+
+	Frame ring[RING_CAPACITY];
+	Frame overflow_frame;
+	// Only the producer stores write_index and only the consumer stores read_index; both only ever grow.
+	SafeNumeric<uint32_t> write_index;
+	SafeNumeric<uint32_t> read_index;
+	SafeNumeric<uint64_t> dropped_frame_count;
+	SafeFlag exit_thread;
+	SafeFlag running;
+	Thread thread;
+
+	Ref<FileAccess> file;
+	// A named pipe is read without blocking through its own descriptor instead of the file, so stop() never waits on an
+	// idle writer. -1 when reading a file.
+	int pipe_fd = -1;
+	uint64_t frames_offset = 0;
+	// Whether the reader moved past the first frame. Only then does start() seek back, since a named pipe can't seek.
+	// Written by the reader thread, read once it has finished.
+	bool frames_read = false;
+	int32_t pin_count = 0;
+	bool loop = false;
+	bool paced = true;
+	Vector<uint8_t> frame_buffer;
+
+	Error _open_source(const String &p_path);
+	void _close_source();
+	// Fills r_buffer, or returns false at the end of the stream or once the reader is asked to exit.
+	bool _read_bytes(uint8_t *r_buffer, int64_t p_size);
+	bool _read_frame(Frame &r_frame);
+	static void _thread_func(void *p_userdata);
+
+protected:
+	static void _bind_methods();
+
+public:
+	// Opens a file of frames, or a named pipe streaming the same format.
+	Error open(const String &p_path);
+	static Error save_frames(const String &p_path, int32_t p_pin_count, const PackedFloat64Array &p_timestamps, const PackedFloat32Array &p_transforms);
+	Error start();
+	void stop();
+	bool is_running() const;
+	int32_t get_pin_count() const;
+	uint64_t get_dropped_frame_count() const;
+	void set_loop(bool p_loop);
+	bool get_loop() const;
+	void set_paced(bool p_paced);
+	bool is_paced() const;
+	// Consumer side. Copies the newest pending frame into r_targets and skips older ones; returns false if none arrived.
+	bool pop_latest(Vector<Transform3D> &r_targets, double *r_timestamp = nullptr);
+
+	IKTargetStream();
+	~IKTargetStream();
+};
+
+#endif // IK_TARGET_STREAM_H
@@ -29,24 +29,34 @@
 /*************************************************************************/
 
 #include "kusudama.h"
+#include "ik_profiler.h"
+#include "ik_solver_counters.h"
 #include "math/ik_transform.h"
 
 IKKusudama::IKKusudama() {
 }
 
 IKKusudama::IKKusudama(Ref<IKBone3D> for_bone) {
-	this->_attached_to = for_bone;
+	this->_attached_to = for_bone->get_instance_id();
 	this->_limiting_axes->set_global_transform(for_bone->get_global_pose());
-	this->_attached_to->add_constraint(Ref<IKKusudama>(this));
+	for_bone->add_constraint(Ref<IKKusudama>(this));
 	this->enable();
 }
 
+uint64_t IKKusudama::get_memory_usage() const {
+	return sizeof(IKKusudama) + limit_cones.size() * sizeof(Ref<LimitCone>) + _limiting_axes->get_memory_usage() + 2 * sizeof(Ray3D);
+}
+
 void IKKusudama::_update_constraint() {
 	update_tangent_radii();
 	update_rotational_freedom();
 }
 
 void IKKusudama::update_tangent_radii() {
+	if (limit_cones_shared) {
+		// Shared cones come with their tangent handles computed and must not be written to.
+		return;
+	}
 	for (int i = 0; i < limit_cones.size(); i++) {
 		Ref<LimitCone> current = limit_cones[i];
 		Ref<LimitCone> next;
@@ -121,6 +131,7 @@ void IKKusudama::set_snap_to_twist_limit(Ref<IKTransform3D> to_set, Ref<IKTransf
 	}
 	rot = Quaternion(axis_y.normalized(), turn_diff).normalized();
 	to_set->rotate_local_with_global(rot);
+	IK_COUNT(twist_snaps, 1);
 }
 
 double IKKusudama::angle_to_twist_center(Ref<IKTransform3D> to_set, Ref<IKTransform3D> limiting_axes) {
@@ -171,17 +182,23 @@ double IKKusudama::signed_angle_difference(double min_angle, double p_super) {
 }
 
 Ref<IKBone3D> IKKusudama::attached_to() {
-	return this->_attached_to;
+	return Object::cast_to<IKBone3D>(ObjectDB::get_instance(_attached_to));
 }
 
-void IKKusudama::add_limit_cone(Vector3 new_cone_local_point, double radius, Ref<LimitCone> previous, Ref<LimitCone> next) {
-	Vector3 localized_point = new_cone_local_point;
-	if (_attached_to.is_valid() && _attached_to->get_parent().is_valid()) {
-		Vector3 globalized_point = _attached_to->get_parent()->get_ik_transform()->get_global_transform().xform(new_cone_local_point);
-		Vector3 offset = _attached_to->get_parent()->get_ik_transform()->get_global_transform().origin - _limiting_axes->get_global_transform().origin;
+Vector3 IKKusudama::_localize_limit_cone_point(Vector3 p_point) {
+	Vector3 localized_point = p_point;
+	Ref<IKBone3D> bone = attached_to();
+	if (bone.is_valid() && bone->get_parent().is_valid()) {
+		Vector3 globalized_point = bone->get_parent()->get_ik_transform()->get_global_transform().xform(p_point);
+		Vector3 offset = bone->get_parent()->get_ik_transform()->get_global_transform().origin - _limiting_axes->get_global_transform().origin;
 		globalized_point += offset;
 		localized_point = _limiting_axes->to_local(globalized_point);
 	}
+	return localized_point;
+}
+
+void IKKusudama::add_limit_cone(Vector3 new_cone_local_point, double radius, Ref<LimitCone> previous, Ref<LimitCone> next) {
+	Vector3 localized_point = _localize_limit_cone_point(new_cone_local_point);
 
 	int insert_at = 0;
 	if (next.is_null() || limit_cones.is_empty()) {
@@ -198,13 +215,51 @@ void IKKusudama::add_limit_cone(Vector3 new_cone_local_point, double radius, Ref
 
 void IKKusudama::remove_limit_cone(Ref<LimitCone> limitCone) {
 	this->limit_cones.erase(limitCone);
+	_unshare_limit_cones();
 }
 
 void IKKusudama::add_limit_cone_at_index(int insert_at, Vector3 new_cone_local_point, double radius) {
-	Ref<LimitCone> newCone = memnew(LimitCone(new_cone_local_point, radius, Ref<IKKusudama>(this)));
+	_unshare_limit_cones();
+	Ref<LimitCone> newCone = memnew(LimitCone(new_cone_local_point, radius));
 	limit_cones.insert(insert_at, newCone);
 }
 
+void IKKusudama::set_limit_cone(int p_index, Vector3 p_new_point, double p_radius) {
+	ERR_FAIL_INDEX(p_index, limit_cones.size());
+	_unshare_limit_cones();
+	Ref<LimitCone> cone = limit_cones[p_index];
+	ERR_FAIL_NULL(cone);
+	cone->set_control_point(p_new_point);
+	cone->set_radius(MAX(DBL_TRUE_MIN, p_radius));
+	cone->set_cushion_boundary(1.0);
+}
+
+void IKKusudama::clear_limit_cones() {
+	limit_cones.clear();
+	limit_cones_shared = false;
+}
+
+void IKKusudama::set_shared_limit_cones(const Vector<Ref<LimitCone>> &p_cones) {
+	limit_cones = p_cones;
+	limit_cones_shared = true;
+}
+
+bool IKKusudama::has_shared_limit_cones() const {
+	return limit_cones_shared;
+}
+
+void IKKusudama::_unshare_limit_cones() {
+	if (!limit_cones_shared) {
+		return;
+	}
+	limit_cones_shared = false;
+	for (int32_t cone_i = 0; cone_i < limit_cones.size(); cone_i++) {
+		Vector3 control_point = limit_cones[cone_i]->get_control_point();
+		limit_cones.write[cone_i] = Ref<LimitCone>(memnew(LimitCone(control_point, limit_cones[cone_i]->get_radius())));
+	}
+	update_tangent_radii();
+}
+
 double IKKusudama::to_tau(double angle) {
 	double result = angle;
 	if (angle < 0) {
@@ -349,6 +404,7 @@ Vector3 IKKusudama::local_point_on_path_sequence(Vector3 in_point, Ref<IKTransfo
  * @return the original point, if it's in limits, or the closest point which is in limits.
  */
 Vector3 IKKusudama::_local_point_in_limits(Vector3 in_point, Vector<double> &in_bounds, int mode) {
+	IK_PROFILE_ZONE("_local_point_in_limits");
 	Vector3 point = in_point.normalized();
 	real_t closest_cos = -2.0;
 	Vector3 closest_collision_point = Vector3(NAN, NAN, NAN);
@@ -409,6 +465,7 @@ void IKKusudama::set_axes_to_orientation_snap(Ref<IKTransform3D> to_set, Ref<IKT
 		constrained_ray->p2(limiting_axes->to_global(in_limits));
 		Quaternion rectified_rot = Quaternion(bone_ray->heading(), constrained_ray->heading());
 		to_set->rotate_local_with_global(rectified_rot);
+		IK_COUNT(orientation_snaps, 1);
 		_ALLOW_DISCARD_ to_set->get_global_transform();
 	}
 }
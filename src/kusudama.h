@@ -60,6 +60,9 @@ protected:
 	 */
 	Vector<Ref<LimitCone>> limit_cones;
 
+	// Set while limit_cones belong to an IKCompiledRig; they are copied before the first edit.
+	bool limit_cones_shared = false;
+
 	/**
 	 * Defined as some Angle in radians about the limiting_axes Y axis, 0 being equivalent to the
 	 * limiting_axes Z axis.
@@ -78,7 +81,11 @@ protected:
 	// per iteration. This should help stabilize solutions somewhat by allowing for soft constraint violations.
 	real_t strength = 1;
 
-	Ref<IKBone3D> _attached_to;
+	// The bone owns its constraint, so only its id is kept here; holding a Ref would keep both alive forever.
+	ObjectID _attached_to;
+
+	Vector3 _localize_limit_cone_point(Vector3 p_point);
+	void _unshare_limit_cones();
 
 public:
 	static const int BOUNDARY = 0;
@@ -194,6 +201,26 @@ public:
 	 */
 	void add_limit_cone_at_index(int insert_at, Vector3 new_point, double radius);
 
+	/**
+	 * Moves and resizes an existing LimitCone in place, without reallocating the cone sequence.
+	 * Call update_tangent_radii() afterwards to refresh the paths between the cones.
+	 *
+	 * @param p_index the index of the LimitCone in the limit_cones array.
+	 * @param p_new_point where on the Kusudama to move the LimitCone (already in the limiting frame, as for add_limit_cone_at_index).
+	 * @param p_radius the new radius of the limitCone
+	 */
+	void set_limit_cone(int p_index, Vector3 p_new_point, double p_radius);
+
+	void clear_limit_cones();
+
+	/**
+	 * Uses limit cones owned by an IKCompiledRig, with their tangent handles already computed.
+	 * They are never written to; the first edit through this Kusudama replaces them with private copies.
+	 */
+	void set_shared_limit_cones(const Vector<Ref<LimitCone>> &p_cones);
+
+	bool has_shared_limit_cones() const;
+
 	static double to_tau(double angle);
 
 	virtual double mod(double x, double y);
@@ -238,6 +265,8 @@ public:
 	void disable();
 
 	void enable();
+	// Bytes held by this constraint and its limiting axes and rays, without its limit cones.
+	uint64_t get_memory_usage() const;
 
 	double unit_hyper_area = 2 * Math::pow(Math_PI, 2);
 	double unit_area = 4 * Math_PI;
@@ -288,6 +317,7 @@ public:
 
 	virtual void set_limit_cones(Vector<Ref<LimitCone>> p_cones) {
 		limit_cones = p_cones;
+		limit_cones_shared = false;
 	}
 
 public:
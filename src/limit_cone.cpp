@@ -45,96 +45,96 @@ void LimitCone::update_tangent_handles(Ref<LimitCone> next) {
 }
 
 void LimitCone::update_tangent_and_cushion_handles(Ref<LimitCone> p_next, int p_mode) {
-	if (p_next.is_valid()) {
-		double radA = this->_get_radius(p_mode);
-		double radB = p_next->_get_radius(p_mode);
+	if (p_next.is_null()) {
+		return;
+	}
+	double radA = this->_get_radius(p_mode);
+	double radB = p_next->_get_radius(p_mode);
 
-		Vector3 A = this->get_control_point();
-		Vector3 B = p_next->get_control_point();
+	Vector3 A = this->get_control_point();
+	Vector3 B = p_next->get_control_point();
 
-		Vector3 arcNormal = A.cross(B);
+	TangentCache &cache = tangent_cache[p_mode];
+	if (cache.valid && cache.control_point == A && cache.next_control_point == B && cache.radius == radA && cache.next_radius == radB) {
+		return;
+	}
 
-		/**
-		 * There are an infinite number of circles co-tangent with A and B, every other
-		 * one of which has a unique radius.
-		 *
-		 * However, we want the radius of our tangent circles to obey the following properties:
-		 *   1) When the radius of A + B == 0, our tangent circle's radius should = 90.
-		 *   	In other words, the tangent circle should span a hemisphere.
-		 *   2) When the radius of A + B == 180, our tangent circle's radius should = 0.
-		 *   	In other words, when A + B combined are capable of spanning the entire sphere,
-		 *   	our tangentCircle should be nothing.
-		 *
-		 * Another way to think of this is -- whatever the maximum distance can be between the
-		 * borders of A and B (presuming their centers are free to move about the circle
-		 * but their radii remain constant), we want our tangentCircle's diameter to be precisely that distance,
-		 * and so, our tangent circles radius should be precisely half of that distance.
-		 */
-		double tRadius = (Math_PI - (radA + radB)) / 2;
+	/**
+	 * There are an infinite number of circles co-tangent with A and B, every other
+	 * one of which has a unique radius.
+	 *
+	 * However, we want the radius of our tangent circles to obey the following properties:
+	 *   1) When the radius of A + B == 0, our tangent circle's radius should = 90.
+	 *   	In other words, the tangent circle should span a hemisphere.
+	 *   2) When the radius of A + B == 180, our tangent circle's radius should = 0.
+	 *   	In other words, when A + B combined are capable of spanning the entire sphere,
+	 *   	our tangentCircle should be nothing.
+	 *
+	 * Another way to think of this is -- whatever the maximum distance can be between the
+	 * borders of A and B (presuming their centers are free to move about the circle
+	 * but their radii remain constant), we want our tangentCircle's diameter to be precisely that distance,
+	 * and so, our tangent circles radius should be precisely half of that distance.
+	 */
+	double tRadius = (Math_PI - (radA + radB)) / 2;
 
-		/**
-		 * Once we have the desired radius for our tangent circle, we may find the solution for its
-		 * centers (usually, there are two).
-		 */
-		double boundaryPlusTangentRadiusA = radA + tRadius;
-		double boundaryPlusTangentRadiusB = radB + tRadius;
-
-		// the axis of this cone, scaled to minimize its distance to the tangent contact points.
-		Vector3 scaledAxisA = A * cos(boundaryPlusTangentRadiusA);
-		// a point on the plane running through the tangent contact points
-		Quaternion temp_var = quaternion_set_axis_angle(arcNormal, boundaryPlusTangentRadiusA);
-		Vector3 planeDir1A = temp_var.xform(A);
-		// another point on the same plane
-		Quaternion tempVar2 = quaternion_set_axis_angle(A, Math_PI / 2);
-		Vector3 planeDir2A = tempVar2.xform(planeDir1A);
-
-		Vector3 scaledAxisB = B * cos(boundaryPlusTangentRadiusB);
-		// a point on the plane running through the tangent contact points
-		Quaternion tempVar3 = quaternion_set_axis_angle(arcNormal, boundaryPlusTangentRadiusB);
-		Vector3 planeDir1B = tempVar3.xform(B);
-		// another point on the same plane
-		Quaternion tempVar4 = quaternion_set_axis_angle(B, Math_PI / 2);
-		Vector3 planeDir2B = tempVar4.xform(planeDir1B);
-
-		// ray from scaled center of next cone to half way point between the circumference of this cone and the next cone.
-		Ref<Ray3D> r1B = memnew(Ray3D(planeDir1B, scaledAxisB));
-		Ref<Ray3D> r2B = memnew(Ray3D(planeDir1B, planeDir2B));
-
-		r1B->elongate(99);
-		r2B->elongate(99);
-
-		Vector3 intersection1 = r1B->intersectsPlane(scaledAxisA, planeDir1A, planeDir2A);
-		Vector3 intersection2 = r2B->intersectsPlane(scaledAxisA, planeDir1A, planeDir2A);
-
-		Ref<Ray3D> intersectionRay = memnew(Ray3D(intersection1, intersection2));
-		intersectionRay->elongate(99);
-
-		Vector3 sphereIntersect1;
-		Vector3 sphereIntersect2;
-		Vector3 sphereCenter;
-		intersectionRay->intersectsSphere(sphereCenter, 1.0f, sphereIntersect1, sphereIntersect2);
-
-		this->set_tangent_circle_center_next_1(sphereIntersect1, p_mode);
-		this->set_tangent_circle_center_next_2(sphereIntersect2, p_mode);
-		this->set_tangent_circle_radius_next(tRadius, p_mode);
-	}
-	if (this->tangent_circle_center_next_1 == Vector3(NAN, NAN, NAN)) {
-		this->tangent_circle_center_next_1 = get_orthogonal(control_point).normalized();
-		this->cushion_tangent_circle_center_next_1 = this->tangent_circle_center_next_1;
-	}
-	if (tangent_circle_center_next_2 == Vector3(NAN, NAN, NAN)) {
-		tangent_circle_center_next_2 = (tangent_circle_center_next_1 * -1).normalized();
-		cushion_tangent_circle_center_next_2 = (cushion_tangent_circle_center_next_2 * -1).normalized();
+	/**
+	 * Once we have the desired radius for our tangent circle, we may find the solution for its
+	 * centers (usually, there are two).
+	 */
+	double boundaryPlusTangentRadiusA = radA + tRadius;
+	double boundaryPlusTangentRadiusB = radB + tRadius;
+
+	Vector3 center_1;
+	Vector3 center_2;
+	if (!compute_tangent_circle_centers(A, B, boundaryPlusTangentRadiusA, boundaryPlusTangentRadiusB, center_1, center_2)) {
+		// The cones share an axis, so any great circle through it will do.
+		center_1 = get_orthogonal(A).normalized();
+		center_2 = center_1 * -1;
 	}
-	if (p_next.is_valid()) {
+
+	this->set_tangent_circle_center_next_1(center_1, p_mode);
+	this->set_tangent_circle_center_next_2(center_2, p_mode);
+	this->set_tangent_circle_radius_next(tRadius, p_mode);
+	if (p_mode == BOUNDARY) {
 		compute_triangles(p_next);
 	}
+
+	cache.control_point = A;
+	cache.next_control_point = B;
+	cache.radius = radA;
+	cache.next_radius = radB;
+	cache.valid = true;
+}
+
+bool LimitCone::compute_tangent_circle_centers(Vector3 p_a, Vector3 p_b, double p_angle_a, double p_angle_b, Vector3 &r_center_1, Vector3 &r_center_2) {
+	// A tangent circle center T sits p_angle_a away from A and p_angle_b away from B on the unit sphere,
+	// so T.A = cos(p_angle_a) and T.B = cos(p_angle_b). Writing T = alpha * A + beta * B + gamma * N,
+	// with N the unit normal of the arc from A to B, solves alpha and beta from the two dot products
+	// and gamma from |T| = 1. The two signs of gamma are the two tangent circles.
+	const Vector3 arc_normal = p_a.cross(p_b);
+	const double arc_normal_length_squared = arc_normal.length_squared();
+	if (Math::is_zero_approx(arc_normal_length_squared)) {
+		return false;
+	}
+	const double a_dot_b = p_a.dot(p_b);
+	const double cos_a = Math::cos(p_angle_a);
+	const double cos_b = Math::cos(p_angle_b);
+	const double alpha = (cos_a - cos_b * a_dot_b) / arc_normal_length_squared;
+	const double beta = (cos_b - cos_a * a_dot_b) / arc_normal_length_squared;
+	const Vector3 in_arc_plane = p_a * alpha + p_b * beta;
+	const double gamma = Math::sqrt(MAX(0.0, 1.0 - in_arc_plane.length_squared()));
+	const Vector3 offset = arc_normal * (gamma / Math::sqrt(arc_normal_length_squared));
+	// determine_if_in_bounds() expects the first center on the negative side of A x B.
+	r_center_1 = (in_arc_plane - offset).normalized();
+	r_center_2 = (in_arc_plane + offset).normalized();
+	return true;
 }
 
 void LimitCone::set_tangent_circle_radius_next(double rad, int mode) {
 	if (mode == CUSHION) {
 		this->cushion_tangent_circle_radius_next = rad;
-		this->cushion_tangent_circle_radius_next = cos(cushion_tangent_circle_radius_next_cos);
+		this->cushion_tangent_circle_radius_next_cos = cos(cushion_tangent_circle_radius_next);
+		return;
 	}
 	this->tangent_circle_radius_next = rad;
 	this->tangent_circle_radius_next_cos = cos(tangent_circle_radius_next);
@@ -183,20 +183,20 @@ double LimitCone::_get_radius_cosine(int mode) {
 }
 
 void LimitCone::compute_triangles(Ref<LimitCone> p_next) {
-	first_triangle_next.write[1] = this->tangent_circle_center_next_1.normalized();
-	first_triangle_next.write[0] = this->get_control_point().normalized();
-	first_triangle_next.write[2] = p_next->get_control_point().normalized();
+	first_triangle_next[1] = this->tangent_circle_center_next_1.normalized();
+	first_triangle_next[0] = this->get_control_point().normalized();
+	first_triangle_next[2] = p_next->get_control_point().normalized();
 
-	second_triangle_next.write[1] = this->tangent_circle_center_next_2.normalized();
-	second_triangle_next.write[0] = this->get_control_point().normalized();
-	second_triangle_next.write[2] = p_next->get_control_point().normalized();
+	second_triangle_next[1] = this->tangent_circle_center_next_2.normalized();
+	second_triangle_next[0] = this->get_control_point().normalized();
+	second_triangle_next[2] = p_next->get_control_point().normalized();
 }
 
 Vector3 LimitCone::get_control_point() const {
 	return control_point;
 }
 
-inline void LimitCone::set_control_point(Vector3 p_control_point) {
+void LimitCone::set_control_point(Vector3 p_control_point) {
 	this->control_point = p_control_point;
 	this->control_point.normalize();
 }
@@ -229,10 +229,6 @@ void LimitCone::set_cushion_boundary(double p_cushion) {
 	this->cushion_cosine = cos(cushion_radius);
 }
 
-Ref<IKKusudama> LimitCone::get_parent_kusudama() {
-	return parent_kusudama;
-}
-
 bool LimitCone::determine_if_in_bounds(Ref<LimitCone> next, Vector3 input) const {
 	/**
 	 * Procedure : Check if input is contained in this cone, or the next cone
@@ -346,8 +342,7 @@ Vector3 LimitCone::get_orthogonal(Vector3 p_in) {
 	return result;
 }
 
-LimitCone::LimitCone(Vector3 direction, double rad, double cushion, Ref<IKKusudama> attached_to) {
-	parent_kusudama = attached_to;
+LimitCone::LimitCone(Vector3 direction, double rad, double cushion) {
 	tangent_circle_center_next_1 = LimitCone::get_orthogonal(direction);
 	tangent_circle_center_next_2 = (tangent_circle_center_next_1 * -1);
 
@@ -360,8 +355,7 @@ LimitCone::LimitCone(Vector3 direction, double rad, double cushion, Ref<IKKusuda
 	this->control_point.normalize();
 }
 
-LimitCone::LimitCone(Vector3 &direction, double rad, Ref<IKKusudama> attached_to) {
-	parent_kusudama = attached_to;
+LimitCone::LimitCone(Vector3 &direction, double rad) {
 	tangent_circle_center_next_1 = direction.normalized();
 	tangent_circle_center_next_2 = (tangent_circle_center_next_1 * -1);
 	this->radius = MAX(DBL_TRUE_MIN, rad);
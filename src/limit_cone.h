@@ -42,6 +42,7 @@
 class IKKusudama;
 class LimitCone : public Resource {
 	GDCLASS(LimitCone, Resource);
+	friend class IKCompiledRig;
 
 public:
 	Vector3 control_point;
@@ -55,9 +56,17 @@ private:
 	double cushion_cosine = 0;
 	double current_cushion = 1;
 
-public:
-	Ref<IKKusudama> parent_kusudama;
+	// Inputs of the last tangent circle solve, indexed by BOUNDARY and CUSHION.
+	struct TangentCache {
+		Vector3 control_point;
+		Vector3 next_control_point;
+		double radius = 0;
+		double next_radius = 0;
+		bool valid = false;
+	};
+	TangentCache tangent_cache[2];
 
+public:
 	Vector3 tangent_circle_center_next_1;
 	Vector3 tangent_circle_center_next_2;
 	double tangent_circle_radius_next = 0;
@@ -84,15 +93,15 @@ public:
 	 * are the points at which the tangent circle intersects this LimitCone and the
 	 * next LimitCone.
 	 */
-	Vector<Vector3> first_triangle_next = { Vector3(), Vector3(), Vector3() };
-	Vector<Vector3> second_triangle_next = { Vector3(), Vector3(), Vector3() };
+	Vector3 first_triangle_next[3];
+	Vector3 second_triangle_next[3];
 
 	virtual ~LimitCone() {
 	}
 
 	LimitCone();
 
-	LimitCone(Vector3 &direction, double rad, Ref<IKKusudama> attached_to);
+	LimitCone(Vector3 &direction, double rad);
 
 	/**
 	 *
@@ -101,12 +110,20 @@ public:
 	 * @param cushion range 0-1, how far toward the boundary to begin slowing down the rotation if soft constraints are enabled.
 	 * Value of 1 creates a hard boundary. Value of 0 means it will always be the case that the closer a joint in the allowable region
 	 * is to the boundary, the more any further rotation in the direction of that boundary will be avoided.
-	 * @param attached_to
 	 */
-	LimitCone(Vector3 direction, double rad, double cushion, Ref<IKKusudama> attached_to);
+	LimitCone(Vector3 direction, double rad, double cushion);
 
 	static Vector3 get_orthogonal(Vector3 p_in);
 
+	/**
+	 * Solves for the centers of the two circles on the unit sphere which lie p_angle_a radians from p_a
+	 * and p_angle_b radians from p_b.
+	 * @param p_a unit length axis of this cone
+	 * @param p_b unit length axis of the next cone
+	 * @return false if p_a and p_b are parallel, in which case the centers are left untouched.
+	 */
+	static bool compute_tangent_circle_centers(Vector3 p_a, Vector3 p_b, double p_angle_a, double p_angle_b, Vector3 &r_center_1, Vector3 &r_center_2);
+
 	/**
 	 *
 	 * @param next
@@ -227,7 +244,5 @@ public:
 	 * is to the boundary, the more any further rotation in the direction of that boundary will be avoided.
 	 */
 	virtual void set_cushion_boundary(double p_cushion);
-
-	virtual Ref<IKKusudama> get_parent_kusudama();
 };
 #endif
@@ -123,6 +123,11 @@ Ref<IKTransform3D> IKTransform3D::get_parent() const {
 	return parent;
 }
 
+uint64_t IKTransform3D::get_memory_usage() const {
+	// Each list element holds the reference and its next, previous and list pointers.
+	return sizeof(IKTransform3D) + children.size() * (sizeof(Ref<IKTransform3D>) + 3 * sizeof(void *));
+}
+
 Vector3 IKTransform3D::to_local(const Vector3 &p_global) const {
 	return get_global_transform().affine_inverse().xform(p_global);
 }
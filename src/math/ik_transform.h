@@ -90,6 +90,8 @@ public:
 	}
 	void orthonormalize();
 	void set_identity();
+	// Bytes held by this transform itself, not by its parent or children.
+	uint64_t get_memory_usage() const;
 };
 
 #endif // IK_TRANSFORM_H
@@ -31,9 +31,26 @@
 #ifndef TEST_EWBIK_H
 #define TEST_EWBIK_H
 
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
 #include "core/math/basis.h"
 #include "core/math/vector3.h"
+#include "core/os/os.h"
+#include "ewbik/ewbik.h"
+#include "ewbik/ik_bone_segment.h"
+#include "ewbik/ik_compiled_rig.h"
+#include "ewbik/ik_effector_3d.h"
+#include "ewbik/ik_effector_template.h"
+#include "ewbik/ik_iteration_budget.h"
+#include "ewbik/ik_solve_scheduler.h"
+#include "ewbik/ik_solver_counters.h"
+#include "ewbik/ik_target_recording.h"
+#include "ewbik/ik_target_stream.h"
+#include "ewbik/kusudama.h"
+#include "ewbik/limit_cone.h"
+#include "ewbik/math/ik_transform.h"
 #include "ewbik/math/qcp.h"
+#include "scene/3d/skeleton_3d.h"
 
 #include "tests/test_macros.h"
 
@@ -102,6 +119,513 @@ TEST_CASE("[Modules][EWBIK] qcp quaternion") {
 	basis_z = Quaternion(Vector3(0.0f, 0.0f, -1.f), Math_PI / 2.0f);
 	rotate_target_headings_quaternion(localizedTipHeadings, localizedTargetHeadings, basis_z);
 }
+
+TEST_CASE("[Modules][EWBIK] limit cone tangent circle centers") {
+	const Vector3 cone_a = Vector3(0.0f, 1.0f, 0.0f);
+	const Vector3 cone_b = Vector3(1.0f, 1.0f, 0.5f).normalized();
+	const real_t radius_a = Math::deg_to_rad(10.0f);
+	const real_t radius_b = Math::deg_to_rad(25.0f);
+	const real_t tangent_radius = (Math_PI - (radius_a + radius_b)) / 2.0f;
+	Vector3 center_1;
+	Vector3 center_2;
+	REQUIRE(LimitCone::compute_tangent_circle_centers(cone_a, cone_b, radius_a + tangent_radius, radius_b + tangent_radius, center_1, center_2));
+	const Vector3 arc_normal = cone_a.cross(cone_b);
+	CHECK_MESSAGE(center_1.dot(arc_normal) < 0.0f, "The first tangent circle should be on the negative side of the arc.");
+	CHECK_MESSAGE(center_2.dot(arc_normal) > 0.0f, "The second tangent circle should be on the positive side of the arc.");
+	for (const Vector3 &center : { center_1, center_2 }) {
+		CHECK(Math::is_equal_approx(center.length(), real_t(1.0f)));
+		CHECK_MESSAGE(Math::is_equal_approx(center.angle_to(cone_a), radius_a + tangent_radius, real_t(1e-4f)), "The tangent circle should touch the first cone.");
+		CHECK_MESSAGE(Math::is_equal_approx(center.angle_to(cone_b), radius_b + tangent_radius, real_t(1e-4f)), "The tangent circle should touch the second cone.");
+	}
+	CHECK_FALSE(LimitCone::compute_tangent_circle_centers(cone_a, cone_a, radius_a + tangent_radius, radius_a + tangent_radius, center_1, center_2));
+}
+
+TEST_CASE("[Modules][EWBIK] compiled rigs are shared between identical configurations") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	skeleton->add_bone("Hips");
+	skeleton->add_bone("Spine");
+	skeleton->set_bone_parent(1, 0);
+	const Vector<StringName> constraint_names = { "Spine" };
+	const Vector<Vector2> twist = { Vector2(0.0f, Math_PI) };
+	const Vector<bool> flip_handedness = { false };
+	Vector<Vector<Vector4>> cones;
+	cones.push_back({ Vector4(0.0f, 1.0f, 0.0f, 0.5f), Vector4(1.0f, 0.0f, 0.0f, 0.3f) });
+
+	Ref<IKCompiledRig> rig = IKCompiledRig::find_or_compile(skeleton, "Hips", constraint_names, twist, flip_handedness, cones);
+	REQUIRE(rig.is_valid());
+	const Vector<Vector<Vector4>> original_cones = cones;
+	CHECK(IKCompiledRig::find_or_compile(skeleton, "Hips", constraint_names, twist, flip_handedness, cones) == rig);
+	REQUIRE(rig->get_constraint_count() == 1);
+	const IKCompiledRig::Constraint &constraint = rig->get_constraints()[0];
+	CHECK(constraint.bone_id == 1);
+	CHECK_MESSAGE(constraint.limit_cones.size() == 2, "Every cone setting should produce a shared limit cone.");
+	CHECK_MESSAGE(constraint.limit_cones[1]->get_control_point().is_equal_approx(Vector3(0.0f, 1.0f, 0.0f)), "Cones should be stored in the kusudama's reverse order.");
+
+	cones.write[0].write[0].w = 0.6f;
+	CHECK_MESSAGE(IKCompiledRig::find_or_compile(skeleton, "Hips", constraint_names, twist, flip_handedness, cones) != rig, "Different settings should not share a rig.");
+
+	const String path = OS::get_singleton()->get_cache_path().path_join("test_ewbik_compiled_rig.ikrig");
+	REQUIRE(rig->save_to_file(path) == OK);
+	Error err;
+	Ref<IKCompiledRig> loaded = IKCompiledRig::load_from_file(path, &err);
+	REQUIRE(err == OK);
+	CHECK(loaded->get_configuration_hash() == rig->get_configuration_hash());
+	CHECK(loaded->matches(skeleton, "Hips", constraint_names, twist, flip_handedness, original_cones));
+	CHECK_FALSE_MESSAGE(loaded->matches(skeleton, "Spine", constraint_names, twist, flip_handedness, original_cones), "A baked rig should be rejected for another root bone.");
+	const Ref<LimitCone> &saved_cone = rig->get_constraints()[0].limit_cones[0];
+	const Ref<LimitCone> &loaded_cone = loaded->get_constraints()[0].limit_cones[0];
+	CHECK(loaded_cone->get_control_point().is_equal_approx(saved_cone->get_control_point()));
+	CHECK_MESSAGE(loaded_cone->get_tangent_circle_center_next_1(LimitCone::BOUNDARY).is_equal_approx(saved_cone->get_tangent_circle_center_next_1(LimitCone::BOUNDARY)), "Tangent circles should be loaded, not recomputed.");
+
+	skeleton->set_bone_rest(1, Transform3D(Basis(), Vector3(0.0f, 1.0f, 0.0f)));
+	CHECK(IKCompiledRig::hash_skeleton(skeleton) != rig->get_skeleton_hash());
+	CHECK_FALSE_MESSAGE(loaded->matches(skeleton, "Hips", constraint_names, twist, flip_handedness, original_cones), "A baked rig should be rejected once the skeleton changes.");
+
+	{
+		// Overwrites the constraint count after the magic, version, skeleton hash, bone count, root bone id,
+		// configuration hash and "Hips" root bone.
+		Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ_WRITE);
+		REQUIRE(file.is_valid());
+		file->seek(6 * 4 + 4 + 4);
+		file->store_32(0x7fffffff);
+	}
+	ERR_PRINT_OFF;
+	Ref<IKCompiledRig> corrupt = IKCompiledRig::load_from_file(path, &err);
+	ERR_PRINT_ON;
+	CHECK_MESSAGE(corrupt.is_null(), "A count larger than the file should be rejected before resizing.");
+	CHECK(err == ERR_FILE_CORRUPT);
+	DirAccess::remove_absolute(path);
+
+	IKCompiledRig::clear_cache();
+	CHECK(IKCompiledRig::get_cache_size() == 0);
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] compiled limit cones match a kusudama built at rest") {
+	// Compiled rigs localize cones against the skeleton's rest. A kusudama built by hand localizes them against the shadow
+	// bones' pose, which is what every rig did before rigs were shared, so the two must agree when the pose is the rest.
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	skeleton->add_bone("Hips");
+	skeleton->add_bone("Spine");
+	skeleton->set_bone_parent(1, 0);
+	skeleton->set_bone_rest(0, Transform3D(Basis(Vector3(0.0f, 1.0f, 0.0f), 0.4f), Vector3(0.0f, 1.0f, 0.0f)));
+	skeleton->set_bone_rest(1, Transform3D(Basis(Vector3(1.0f, 0.0f, 0.0f), -0.7f), Vector3(0.0f, 0.2f, 0.1f)));
+	const Vector4 cone_setting(0.3f, 1.0f, -0.2f, 0.5f);
+	Vector<Vector<Vector4>> cones;
+	cones.push_back({ cone_setting });
+	Ref<IKCompiledRig> rig = IKCompiledRig::compile(skeleton, "Hips", { "Spine" }, { Vector2(0.0f, Math_PI) }, { false }, cones);
+	REQUIRE(rig.is_valid());
+	REQUIRE(rig->get_constraints()[0].limit_cones.size() == 1);
+
+	Vector<Ref<IKEffectorTemplate>> pins;
+	Ref<IKBone3D> hips = memnew(IKBone3D("Hips", skeleton, Ref<IKBone3D>(), pins));
+	Ref<IKBone3D> spine = memnew(IKBone3D("Spine", skeleton, hips, pins));
+	hips->set_global_pose(skeleton->get_bone_global_rest(0));
+	spine->set_global_pose(skeleton->get_bone_global_rest(1));
+	Ref<IKKusudama> kusudama = memnew(IKKusudama(spine));
+	kusudama->add_limit_cone(Vector3(cone_setting.x, cone_setting.y, cone_setting.z), cone_setting.w);
+	REQUIRE(kusudama->get_limit_cones().size() == 1);
+	const Vector3 posed_point = kusudama->get_limit_cones()[0]->get_control_point().normalized();
+	const Vector3 compiled_point = rig->get_constraints()[0].limit_cones[0]->get_control_point().normalized();
+	CHECK_MESSAGE(compiled_point.is_equal_approx(posed_point), "Localizing against the rest should match localizing against a pose at rest.");
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] patched kusudamas match rebuilt ones") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	skeleton->add_bone("Hips");
+	skeleton->add_bone("Spine");
+	skeleton->set_bone_parent(1, 0);
+	skeleton->set_bone_rest(0, Transform3D(Basis(Vector3(0.0f, 1.0f, 0.0f), 0.4f), Vector3(0.0f, 1.0f, 0.0f)));
+	skeleton->set_bone_rest(1, Transform3D(Basis(Vector3(1.0f, 0.0f, 0.0f), -0.7f), Vector3(0.0f, 0.2f, 0.1f)));
+	const Vector<StringName> constraint_names = { "Spine" };
+	Vector<Vector<Vector4>> old_cones;
+	old_cones.push_back({ Vector4(0.0f, 1.0f, 0.0f, 0.5f), Vector4(1.0f, 0.0f, 0.0f, 0.3f) });
+	Vector<Vector<Vector4>> new_cones;
+	new_cones.push_back({ Vector4(0.3f, 1.0f, -0.2f, 0.4f), Vector4(0.8f, 0.1f, 0.2f, 0.6f) });
+	const Vector2 new_twist(0.2f, 1.5f);
+	Ref<IKCompiledRig> old_rig = IKCompiledRig::compile(skeleton, "Hips", constraint_names, { Vector2(0.0f, Math_PI) }, { false }, old_cones);
+	Ref<IKCompiledRig> new_rig = IKCompiledRig::compile(skeleton, "Hips", constraint_names, { new_twist }, { true }, new_cones);
+	REQUIRE(old_rig.is_valid());
+	REQUIRE(new_rig.is_valid());
+	const Vector3 old_shared_point = old_rig->get_constraints()[0].limit_cones[0]->get_control_point();
+
+	Vector<Ref<IKEffectorTemplate>> pins;
+	Ref<IKBone3D> spines[2];
+	for (Ref<IKBone3D> &spine : spines) {
+		Ref<IKBone3D> hips = memnew(IKBone3D("Hips", skeleton, Ref<IKBone3D>(), pins));
+		spine = memnew(IKBone3D("Spine", skeleton, hips, pins));
+		hips->set_global_pose(skeleton->get_bone_global_rest(0));
+		spine->set_global_pose(skeleton->get_bone_global_rest(1));
+	}
+	// The steps EWBIK takes when a constraint is edited after the rig was built, against a rig built with the new settings.
+	const Ref<IKBone3D> &patched = spines[0];
+	const Ref<IKBone3D> &rebuilt = spines[1];
+	IKCompiledRig::attach_constraint(old_rig->get_constraints()[0], patched);
+	IKCompiledRig::patch_constraint(skeleton, patched, new_cones[0], new_twist);
+	patched->set_flip_handedness(true);
+	IKCompiledRig::attach_constraint(new_rig->get_constraints()[0], rebuilt);
+
+	const Vector<Ref<LimitCone>> &patched_cones = patched->get_constraint()->get_limit_cones();
+	const Vector<Ref<LimitCone>> &rebuilt_cones = rebuilt->get_constraint()->get_limit_cones();
+	REQUIRE(patched_cones.size() == rebuilt_cones.size());
+	for (int32_t cone_i = 0; cone_i < patched_cones.size(); cone_i++) {
+		CHECK(patched_cones[cone_i]->get_control_point().is_equal_approx(rebuilt_cones[cone_i]->get_control_point()));
+		CHECK(patched_cones[cone_i]->get_radius() == doctest::Approx(rebuilt_cones[cone_i]->get_radius()));
+		CHECK_MESSAGE(patched_cones[cone_i]->get_tangent_circle_center_next_1(LimitCone::BOUNDARY).is_equal_approx(rebuilt_cones[cone_i]->get_tangent_circle_center_next_1(LimitCone::BOUNDARY)), "Patching should refresh the tangent circles.");
+		CHECK(patched_cones[cone_i]->get_tangent_circle_radius_next(LimitCone::BOUNDARY) == doctest::Approx(rebuilt_cones[cone_i]->get_tangent_circle_radius_next(LimitCone::BOUNDARY)));
+	}
+	CHECK(patched->get_constraint()->min_axial_angle() == doctest::Approx(rebuilt->get_constraint()->min_axial_angle()));
+	CHECK(patched->get_constraint()->max_axial_angle() == doctest::Approx(rebuilt->get_constraint()->max_axial_angle()));
+	CHECK(patched->get_constraint_transform()->get_global_chirality() == rebuilt->get_constraint_transform()->get_global_chirality());
+	CHECK(patched->get_ik_transform()->get_global_chirality() == rebuilt->get_ik_transform()->get_global_chirality());
+	CHECK(rebuilt->get_ik_transform()->get_global_chirality() == -1.0f);
+	CHECK_MESSAGE(old_rig->get_constraints()[0].limit_cones[0]->get_control_point().is_equal_approx(old_shared_point), "Patching should copy the shared cones, not edit them.");
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] target recordings round trip") {
+	const String path = OS::get_singleton()->get_cache_path().path_join("test_ewbik_recording.ewrc");
+	const Transform3D root_parent(Basis(Vector3(0.0f, 1.0f, 0.0f), Math_PI / 2.0f), Vector3(1.0f, 2.0f, 3.0f));
+	Transform3D poses[2] = { Transform3D(Basis(), Vector3(0.0f, 1.0f, 0.0f)), Transform3D(Basis(Vector3(1.0f, 0.0f, 0.0f), 0.25f), Vector3()) };
+	Transform3D target(Basis(), Vector3(0.5f, 1.5f, -0.5f));
+
+	IKTargetRecording::FrameSolve solve;
+	solve.iterations = 3;
+	solve.schedule_start = 6;
+	solve.schedule_iterations = 10;
+
+	IKTargetRecording recording;
+	REQUIRE(recording.begin_write(path, 1234u, 2, 1) == OK);
+	recording.write_frame(1.0 / 60.0, solve, root_parent, poses, &target);
+	recording.write_frame(1.0 / 30.0, IKTargetRecording::FrameSolve(), root_parent, poses, &target);
+	recording.close();
+
+	IKTargetRecording replay;
+	REQUIRE(replay.open(path) == OK);
+	CHECK(replay.get_skeleton_hash() == 1234u);
+	CHECK(replay.get_bone_count() == 2);
+	CHECK(replay.get_effector_count() == 1);
+	double delta = 0.0;
+	IKTargetRecording::FrameSolve read_solve;
+	Transform3D read_root_parent;
+	Transform3D read_poses[2];
+	Transform3D read_target;
+	REQUIRE(replay.read_frame(delta, read_solve, read_root_parent, read_poses, &read_target));
+	CHECK(delta == doctest::Approx(1.0 / 60.0));
+	CHECK(read_solve.iterations == 3);
+	CHECK_MESSAGE(read_solve.schedule_start == 6, "An amortized frame should replay from the middle of its damp schedule.");
+	CHECK(read_solve.schedule_iterations == 10);
+	CHECK(read_root_parent.is_equal_approx(root_parent));
+	CHECK(read_poses[1].is_equal_approx(poses[1]));
+	CHECK(read_target.is_equal_approx(target));
+	REQUIRE(replay.read_frame(delta, read_solve, read_root_parent, read_poses, &read_target));
+	CHECK(delta == doctest::Approx(1.0 / 30.0));
+	CHECK_FALSE_MESSAGE(replay.read_frame(delta, read_solve, read_root_parent, read_poses, &read_target), "Reading past the last frame should report the end of the recording.");
+	replay.close();
+
+	// A header claiming more bones than the frames that follow could hold.
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ_WRITE);
+	REQUIRE(file.is_valid());
+	file->seek(12);
+	file->store_32(0x7fffffff);
+	file.unref();
+	ERR_PRINT_OFF;
+	CHECK(replay.open(path) == ERR_FILE_CORRUPT);
+	ERR_PRINT_ON;
+	CHECK_FALSE(replay.is_open());
+	DirAccess::remove_absolute(path);
+}
+
+TEST_CASE("[Modules][EWBIK] target streams deliver the newest frame the ring holds") {
+	const String path = OS::get_singleton()->get_cache_path().path_join("test_ewbik_target_stream.ewts");
+	// Twenty frames of one pin, each moved one unit further along x, against a ring of sixteen.
+	const int32_t frame_count = IKTargetStream::RING_CAPACITY + 4;
+	PackedFloat64Array timestamps;
+	PackedFloat32Array transforms;
+	for (int32_t frame_i = 0; frame_i < frame_count; frame_i++) {
+		timestamps.push_back(frame_i / 60.0);
+		float floats[12];
+		IKEffector3D::transform_to_floats(Transform3D(Basis(), Vector3(frame_i, 0.0f, 0.0f)), floats);
+		for (float value : floats) {
+			transforms.push_back(value);
+		}
+	}
+	REQUIRE(IKTargetStream::save_frames(path, 1, timestamps, transforms) == OK);
+
+	Ref<IKTargetStream> stream;
+	stream.instantiate();
+	REQUIRE(stream->open(path) == OK);
+	CHECK(stream->get_pin_count() == 1);
+	stream->set_paced(false);
+	Vector<Transform3D> targets;
+	double timestamp = 0.0;
+	for (int32_t run_i = 0; run_i < 2; run_i++) {
+		REQUIRE(stream->start() == OK);
+		// The reader stops by itself at the end of a stream that doesn't loop.
+		for (int32_t wait_i = 0; wait_i < 1000 && stream->is_running(); wait_i++) {
+			OS::get_singleton()->delay_usec(1000);
+		}
+		REQUIRE_FALSE(stream->is_running());
+		CHECK_MESSAGE(stream->get_dropped_frame_count() == uint64_t(4 * (run_i + 1)), "Frames past a full ring should be dropped, not waited for.");
+		REQUIRE(stream->pop_latest(targets, &timestamp));
+		REQUIRE(targets.size() == 1);
+		CHECK_MESSAGE(targets[0].origin.is_equal_approx(Vector3(IKTargetStream::RING_CAPACITY - 1, 0.0f, 0.0f)), "The newest frame in the ring should arrive, starting over from the first frame on every start.");
+		CHECK(timestamp == doctest::Approx((IKTargetStream::RING_CAPACITY - 1) / 60.0));
+		CHECK_FALSE_MESSAGE(stream->pop_latest(targets), "A frame should only be delivered once.");
+	}
+	stream->stop();
+
+	for (const int32_t corrupt_pin_count : { -1, IKTargetStream::MAX_PIN_COUNT + 1 }) {
+		Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+		REQUIRE(file.is_valid());
+		file->store_buffer((const uint8_t *)"EWTS", 4);
+		file->store_32(IKTargetStream::FORMAT_VERSION);
+		file->store_32(corrupt_pin_count);
+		file.unref();
+		ERR_PRINT_OFF;
+		CHECK_MESSAGE(stream->open(path) == ERR_FILE_CORRUPT, "A pin count no stream could hold should be rejected before anything is allocated.");
+		ERR_PRINT_ON;
+	}
+	stream.unref();
+	DirAccess::remove_absolute(path);
+}
+
+// A hips bone with a three-bone leg on each side, pinned at the feet.
+struct LegRig {
+	Skeleton3D *skeleton = nullptr;
+	Vector<Ref<IKEffectorTemplate>> pins;
+	Ref<IKTransform3D> root_transform;
+	Ref<IKBoneSegment> segmented_skeleton;
+	Vector<Ref<IKBone3D>> bone_list;
+
+	// Same steps as EWBIK::_compile_rig, without constraints: a hips segment with a segment for each leg. Every pin
+	// starts on its target.
+	void build() {
+		const BoneId hips = skeleton->find_bone("Hips");
+		root_transform.instantiate();
+		segmented_skeleton = Ref<IKBoneSegment>(memnew(IKBoneSegment(skeleton, "Hips", pins, nullptr, hips, -1)));
+		segmented_skeleton->get_root()->get_ik_transform()->set_parent(root_transform);
+		segmented_skeleton->generate_default_segments_from_root(pins, hips, -1);
+		segmented_skeleton->create_bone_list(bone_list, true, false);
+		Vector<Vector<real_t>> weight_array;
+		segmented_skeleton->update_pinned_list(weight_array);
+		segmented_skeleton->recursive_create_headings_arrays_for(segmented_skeleton);
+		for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+			const Ref<IKBone3D> &bone = bone_list[bone_i];
+			bone->set_global_pose(skeleton->get_bone_global_pose(bone->get_bone_id()));
+			if (bone->is_pinned()) {
+				bone->get_pin()->set_target_global_transform(bone->get_global_pose());
+			}
+		}
+	}
+	Ref<IKEffector3D> find_pin(const String &p_bone) const {
+		for (const Ref<IKBone3D> &bone : bone_list) {
+			if (bone->is_pinned() && bone->get_bone_id() == skeleton->find_bone(p_bone)) {
+				return bone->get_pin();
+			}
+		}
+		return Ref<IKEffector3D>();
+	}
+
+	LegRig() {
+		skeleton = memnew(Skeleton3D);
+		skeleton->add_bone("Hips");
+		skeleton->set_bone_rest(0, Transform3D(Basis(), Vector3(0.0f, 1.0f, 0.0f)));
+		skeleton->set_bone_pose_position(0, Vector3(0.0f, 1.0f, 0.0f));
+		for (const String &side : { String("Left"), String("Right") }) {
+			const real_t sign = side == "Left" ? 1.0f : -1.0f;
+			const Vector3 offsets[] = { Vector3(sign * 0.1f, -0.05f, 0.0f), Vector3(0.0f, -0.45f, 0.0f), Vector3(0.0f, -0.45f, 0.0f) };
+			const String names[] = { side + "UpperLeg", side + "LowerLeg", side + "Foot" };
+			String parent = "Hips";
+			for (int32_t bone_i = 0; bone_i < 3; bone_i++) {
+				skeleton->add_bone(names[bone_i]);
+				const BoneId bone = skeleton->get_bone_count() - 1;
+				skeleton->set_bone_parent(bone, skeleton->find_bone(parent));
+				skeleton->set_bone_rest(bone, Transform3D(Basis(), offsets[bone_i]));
+				skeleton->set_bone_pose_position(bone, offsets[bone_i]);
+				parent = names[bone_i];
+			}
+			Ref<IKEffectorTemplate> pin;
+			pin.instantiate();
+			pin->set_name(parent);
+			pins.push_back(pin);
+		}
+	}
+	~LegRig() {
+		memdelete(skeleton);
+	}
+};
+
+TEST_CASE("[Modules][EWBIK] settled segments are skipped while a sibling keeps solving") {
+	LegRig rig;
+	rig.build();
+	Ref<IKBoneSegment> segmented_skeleton = rig.segmented_skeleton;
+	Ref<IKEffector3D> right_foot = rig.find_pin("RightFoot");
+	REQUIRE(right_foot.is_valid());
+
+	const real_t damp = Math::deg_to_rad(15.0f);
+	const real_t tolerance = 1e-4f;
+	IKSolverCounters counters;
+	IKSolverCounters::current = &counters;
+	CHECK_FALSE_MESSAGE(segmented_skeleton->segment_solver(damp, tolerance), "A rig already on its targets should stop after the first pass.");
+	CHECK_MESSAGE(counters.converged_segments == 3, "The hips and both legs should be skipped.");
+	CHECK(counters.qcp_calls == 0);
+
+	Transform3D target = right_foot->get_target_global_transform();
+	target.origin += Vector3(0.0f, 0.2f, 0.1f);
+	right_foot->set_target_global_transform(target);
+	counters = IKSolverCounters();
+	CHECK_MESSAGE(segmented_skeleton->segment_solver(damp, tolerance), "An unsettled leg should keep the solve going.");
+	CHECK_MESSAGE(counters.converged_segments == 1, "Only the settled left leg should be skipped; the hips move with the right leg.");
+	IKSolverCounters::current = nullptr;
+}
+
+static void check_same_heading_weights(const Ref<IKBoneSegment> &p_patched, const Ref<IKBoneSegment> &p_rebuilt) {
+	const Vector<real_t> &patched_weights = p_patched->get_heading_weights();
+	const Vector<real_t> &rebuilt_weights = p_rebuilt->get_heading_weights();
+	REQUIRE(patched_weights.size() == rebuilt_weights.size());
+	for (int32_t weight_i = 0; weight_i < patched_weights.size(); weight_i++) {
+		CHECK(patched_weights[weight_i] == doctest::Approx(rebuilt_weights[weight_i]));
+	}
+	const Vector<Ref<IKBoneSegment>> patched_children = p_patched->get_child_segments();
+	const Vector<Ref<IKBoneSegment>> rebuilt_children = p_rebuilt->get_child_segments();
+	REQUIRE(patched_children.size() == rebuilt_children.size());
+	for (int32_t child_i = 0; child_i < patched_children.size(); child_i++) {
+		check_same_heading_weights(patched_children[child_i], rebuilt_children[child_i]);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] in-place pin updates match a rebuild") {
+	// The hips pin's falloff scales the feet's headings in the hips segment, so every setting reaches a penalty array.
+	const real_t weight = 0.4f;
+	const real_t falloff = 0.3f;
+	const Vector3 priorities(0.5f, 0.0f, 0.9f);
+	LegRig patched;
+	LegRig rebuilt;
+	for (LegRig *rig : { &patched, &rebuilt }) {
+		Ref<IKEffectorTemplate> hips_pin;
+		hips_pin.instantiate();
+		hips_pin->set_name("Hips");
+		rig->pins.push_back(hips_pin);
+	}
+	const int32_t hips_pin_index = patched.pins.size() - 1;
+	rebuilt.pins[hips_pin_index]->set_weight(weight);
+	rebuilt.pins[hips_pin_index]->set_depth_falloff(falloff);
+	rebuilt.pins[hips_pin_index]->set_direction_priorities(priorities);
+	rebuilt.pins[0]->set_weight(weight);
+	patched.build();
+	rebuilt.build();
+
+	// The steps EWBIK::update_pin_weights takes when the heading layout stays the same.
+	Ref<IKEffector3D> hips = patched.find_pin("Hips");
+	Ref<IKEffector3D> left_foot = patched.find_pin("LeftFoot");
+	REQUIRE(hips.is_valid());
+	REQUIRE(left_foot.is_valid());
+	const int32_t heading_count = hips->get_heading_count();
+	hips->set_weight(weight);
+	hips->set_depth_falloff(falloff);
+	hips->set_direction_priorities(priorities);
+	left_foot->set_weight(weight);
+	REQUIRE(hips->get_heading_count() == heading_count);
+	IKBoneSegment::recursive_update_heading_weights_for(patched.segmented_skeleton);
+	check_same_heading_weights(patched.segmented_skeleton, rebuilt.segmented_skeleton);
+
+	// The headings are built from the weights on every solve, so both rigs should take the same step.
+	const real_t damp = Math::deg_to_rad(15.0f);
+	for (LegRig *rig : { &patched, &rebuilt }) {
+		Ref<IKEffector3D> right_foot = rig->find_pin("RightFoot");
+		Transform3D target = right_foot->get_target_global_transform();
+		target.origin += Vector3(0.0f, 0.2f, 0.1f);
+		target.basis = Basis(Vector3(0.0f, 1.0f, 0.0f), 0.5f) * target.basis;
+		right_foot->set_target_global_transform(target);
+		rig->segmented_skeleton->segment_solver(damp);
+	}
+	REQUIRE(patched.bone_list.size() == rebuilt.bone_list.size());
+	for (int32_t bone_i = 0; bone_i < patched.bone_list.size(); bone_i++) {
+		CHECK(patched.bone_list[bone_i]->get_global_pose().is_equal_approx(rebuilt.bone_list[bone_i]->get_global_pose()));
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] configuring from a dictionary goes through the setters") {
+	EWBIK *ewbik = memnew(EWBIK);
+	ewbik->set_initial_damp(Math::deg_to_rad(30.0f));
+	ewbik->set_pin_count(3);
+	ewbik->set_pin_weight(0, 0.25f);
+
+	Dictionary head_pin;
+	head_pin["name"] = "Head";
+	Dictionary hand_pin;
+	hand_pin["name"] = "LeftHand";
+	hand_pin["weight"] = 0.5f;
+	Array pin_array;
+	pin_array.push_back(head_pin);
+	pin_array.push_back(hand_pin);
+	Dictionary configuration;
+	configuration["max_ik_iterations"] = 7;
+	configuration["initial_damp"] = -1.0f;
+	configuration["pins"] = pin_array;
+	ERR_PRINT_OFF;
+	ewbik->configure_from_dictionary(configuration);
+	ERR_PRINT_ON;
+
+	CHECK(ewbik->get_max_ik_iterations() == doctest::Approx(7.0f));
+	CHECK_MESSAGE(ewbik->get_initial_damp() == doctest::Approx(Math::deg_to_rad(30.0f)), "A negative initial damp should be rejected as its setter rejects it.");
+	REQUIRE(ewbik->get_pin_count() == 2);
+	CHECK(ewbik->get_pin_bone_name(0) == StringName("Head"));
+	CHECK_MESSAGE(ewbik->get_pin_weight(0) == doctest::Approx(1.0f), "Pins should be replaced, so a weight left out takes the default.");
+	CHECK(ewbik->get_pin_weight(1) == doctest::Approx(0.5f));
+	memdelete(ewbik);
+}
+
+TEST_CASE("[Modules][EWBIK] damp schedule shrinks to the default damp") {
+	const real_t damp = Math::deg_to_rad(15.0f);
+	const real_t initial_damp = Math::deg_to_rad(60.0f);
+	CHECK(IKBoneSegment::get_scheduled_damp(initial_damp, damp, 0, 10) == doctest::Approx(initial_damp));
+	CHECK(IKBoneSegment::get_scheduled_damp(initial_damp, damp, 9, 10) == doctest::Approx(damp));
+	CHECK_MESSAGE(IKBoneSegment::get_scheduled_damp(initial_damp, damp, 20, 10) == doctest::Approx(damp), "Iterations past the schedule should keep the default damp.");
+	CHECK(IKBoneSegment::get_scheduled_damp(initial_damp, damp, 3, 10) > IKBoneSegment::get_scheduled_damp(initial_damp, damp, 6, 10));
+	CHECK_MESSAGE(IKBoneSegment::get_scheduled_damp(0.0, damp, 0, 10) == doctest::Approx(damp), "No initial damp should keep the damp constant.");
+}
+
+TEST_CASE("[Modules][EWBIK] iteration budget favors the rig with the most error") {
+	const ObjectID far_rig = ObjectID(uint64_t(1));
+	const ObjectID near_rig = ObjectID(uint64_t(2));
+	IKIterationBudget::clear();
+	IKIterationBudget::set_budget_usec(1000);
+	CHECK_MESSAGE(IKIterationBudget::get_iterations(far_rig, 10, 1) == 10, "A new rig should solve all its iterations to be measured.");
+	CHECK(IKIterationBudget::get_iterations(near_rig, 10, 1) == 10);
+	// Both cost 100 usec an iteration, the first ends ten times further from its targets.
+	IKIterationBudget::report(far_rig, 10, 1000, 0, 1.0);
+	IKIterationBudget::report(near_rig, 10, 1000, 0, 0.1);
+	const int32_t far_iterations = IKIterationBudget::get_iterations(far_rig, 10, 2);
+	const int32_t near_iterations = IKIterationBudget::get_iterations(near_rig, 10, 2);
+	CHECK(far_iterations == 9);
+	CHECK(near_iterations == 1);
+	CHECK_MESSAGE((far_iterations + near_iterations) * 100 <= 1000, "The rigs should fit in the budget.");
+	CHECK_MESSAGE(IKIterationBudget::get_iterations(far_rig, 10, 4) == 10, "A rig that skipped a frame should be measured again.");
+	IKIterationBudget::set_budget_usec(0);
+	IKIterationBudget::clear();
+}
+
+TEST_CASE("[Modules][EWBIK] staggered solves spread evenly over frames") {
+	IKSolveScheduler::clear();
+	int32_t solves_per_frame[4] = {};
+	for (uint64_t frame = 0; frame < 4; frame++) {
+		for (uint64_t rig_i = 1; rig_i <= 8; rig_i++) {
+			if (IKSolveScheduler::is_due(ObjectID(rig_i), 4, 10, frame)) {
+				solves_per_frame[frame]++;
+			}
+		}
+	}
+	for (int32_t frame_i = 0; frame_i < 4; frame_i++) {
+		CHECK_MESSAGE(solves_per_frame[frame_i] == 2, "Eight rigs solving every fourth frame should solve two a frame.");
+	}
+	CHECK(IKSolveScheduler::is_due(ObjectID(uint64_t(1)), 1, 10, 3));
+	IKSolveScheduler::clear();
+}
 } // namespace TestEWBIK
 
 #endif
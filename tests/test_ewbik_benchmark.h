@@ -0,0 +1,342 @@
+/*************************************************************************/
+/*  test_ewbik_benchmark.h                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TEST_EWBIK_BENCHMARK_H
+#define TEST_EWBIK_BENCHMARK_H
+
+#include "core/math/random_pcg.h"
+#include "core/os/os.h"
+#include "ewbik/ik_bone_3d.h"
+#include "ewbik/ik_bone_segment.h"
+#include "ewbik/ik_effector_template.h"
+#include "ewbik/kusudama.h"
+#include "ewbik/math/ik_transform.h"
+#include "ewbik/math/qcp.h"
+#include "scene/3d/skeleton_3d.h"
+
+#include "tests/test_macros.h"
+
+// Benchmarks are skipped by default. Run them with:
+// godot --test --test-case="*[Benchmark]*" --no-skip
+namespace TestEWBIKBenchmark {
+// Repeats p_op until at least p_min_usec have passed, after a short warm up, and prints the cost of one operation.
+// p_op performs p_ops_per_call operations per call, so that very cheap operations don't measure the clock.
+template <typename F>
+void run_benchmark(const String &p_name, int64_t p_ops_per_call, F p_op, uint64_t p_min_usec = 200000) {
+	for (int32_t i = 0; i < 8; i++) {
+		p_op();
+	}
+	int64_t calls = 0;
+	const uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+	uint64_t elapsed_usec = 0;
+	do {
+		p_op();
+		calls++;
+		elapsed_usec = OS::get_singleton()->get_ticks_usec() - start_usec;
+	} while (elapsed_usec < p_min_usec);
+	const int64_t ops = calls * p_ops_per_call;
+	const double ns_per_op = double(elapsed_usec) * 1000.0 / ops;
+	print_line(vformat("[EWBIK benchmark] %s: %.1f ns/op, %.0f op/s (%d ops).", p_name, ns_per_op, 1.0e9 / ns_per_op, ops));
+}
+
+struct BenchmarkRig {
+	Skeleton3D *skeleton = nullptr;
+	Vector<Ref<IKEffectorTemplate>> pins;
+	Ref<IKTransform3D> root_transform;
+	Ref<IKBoneSegment> segmented_skeleton;
+	Vector<Ref<IKBone3D>> bone_list;
+	Vector<Ref<IKEffector3D>> effectors;
+	Vector<Transform3D> rest_targets;
+
+	void add_bone(const String &p_name, const String &p_parent, const Vector3 &p_offset) {
+		skeleton->add_bone(p_name);
+		const BoneId bone = skeleton->get_bone_count() - 1;
+		if (!p_parent.is_empty()) {
+			skeleton->set_bone_parent(bone, skeleton->find_bone(p_parent));
+		}
+		skeleton->set_bone_rest(bone, Transform3D(Basis(), p_offset));
+		skeleton->set_bone_pose_position(bone, p_offset);
+	}
+	void add_pin(const String &p_bone) {
+		Ref<IKEffectorTemplate> pin;
+		pin.instantiate();
+		pin->set_name(p_bone);
+		pins.push_back(pin);
+	}
+	// Same steps as EWBIK::_compile_rig, without constraints.
+	void build(const String &p_root_bone) {
+		const BoneId root_bone_index = skeleton->find_bone(p_root_bone);
+		root_transform.instantiate();
+		segmented_skeleton = Ref<IKBoneSegment>(memnew(IKBoneSegment(skeleton, p_root_bone, pins, nullptr, root_bone_index, -1)));
+		segmented_skeleton->get_root()->get_ik_transform()->set_parent(root_transform);
+		segmented_skeleton->generate_default_segments_from_root(pins, root_bone_index, -1);
+		segmented_skeleton->create_bone_list(bone_list, true, false);
+		Vector<Vector<real_t>> weight_array;
+		segmented_skeleton->update_pinned_list(weight_array);
+		segmented_skeleton->recursive_create_headings_arrays_for(segmented_skeleton);
+		reset_pose();
+		for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+			const Ref<IKBone3D> &bone = bone_list[bone_i];
+			if (bone->is_pinned()) {
+				effectors.push_back(bone->get_pin());
+				rest_targets.push_back(bone->get_ik_transform()->get_global_transform());
+			}
+		}
+	}
+	// Puts every shadow bone back in the skeleton's pose, parents first.
+	void reset_pose() {
+		for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
+			const Ref<IKBone3D> &bone = bone_list[bone_i];
+			bone->set_global_pose(skeleton->get_bone_global_pose(bone->get_bone_id()));
+		}
+	}
+	// Sweeps every target around its rest position so the solver never settles.
+	void move_targets(int64_t p_frame) {
+		const real_t phase = p_frame * real_t(0.05);
+		for (int32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+			const Vector3 offset = Vector3(Math::sin(phase + effector_i), Math::cos(phase * real_t(0.7)), Math::sin(phase * real_t(1.3))) * real_t(0.1);
+			Transform3D target = rest_targets[effector_i];
+			target.origin += offset;
+			target.basis = Basis(Vector3(0.0f, 1.0f, 0.0f), Math::sin(phase) * real_t(0.5)) * target.basis;
+			effectors.write[effector_i]->set_target_global_transform(target);
+		}
+	}
+
+	BenchmarkRig() {
+		skeleton = memnew(Skeleton3D);
+	}
+	~BenchmarkRig() {
+		memdelete(skeleton);
+	}
+};
+
+void build_chain(BenchmarkRig &r_rig, int32_t p_bone_count) {
+	for (int32_t bone_i = 0; bone_i < p_bone_count; bone_i++) {
+		r_rig.add_bone(vformat("Bone%d", bone_i), bone_i ? vformat("Bone%d", bone_i - 1) : String(), Vector3(0.0f, 0.1f, 0.0f));
+	}
+	r_rig.add_pin(vformat("Bone%d", p_bone_count - 1));
+	r_rig.build("Bone0");
+}
+
+void build_humanoid(BenchmarkRig &r_rig) {
+	r_rig.add_bone("Hips", "", Vector3(0.0f, 1.0f, 0.0f));
+	r_rig.add_bone("Spine", "Hips", Vector3(0.0f, 0.1f, 0.0f));
+	r_rig.add_bone("Chest", "Spine", Vector3(0.0f, 0.15f, 0.0f));
+	r_rig.add_bone("UpperChest", "Chest", Vector3(0.0f, 0.15f, 0.0f));
+	r_rig.add_bone("Neck", "UpperChest", Vector3(0.0f, 0.15f, 0.0f));
+	r_rig.add_bone("Head", "Neck", Vector3(0.0f, 0.1f, 0.0f));
+	for (const String &side : { String("Left"), String("Right") }) {
+		const real_t sign = side == "Left" ? 1.0f : -1.0f;
+		r_rig.add_bone(side + "Shoulder", "UpperChest", Vector3(sign * 0.05f, 0.1f, 0.0f));
+		r_rig.add_bone(side + "UpperArm", side + "Shoulder", Vector3(sign * 0.1f, 0.0f, 0.0f));
+		r_rig.add_bone(side + "LowerArm", side + "UpperArm", Vector3(sign * 0.25f, 0.0f, 0.0f));
+		r_rig.add_bone(side + "Hand", side + "LowerArm", Vector3(sign * 0.25f, 0.0f, 0.0f));
+		r_rig.add_bone(side + "UpperLeg", "Hips", Vector3(sign * 0.1f, -0.05f, 0.0f));
+		r_rig.add_bone(side + "LowerLeg", side + "UpperLeg", Vector3(0.0f, -0.45f, 0.0f));
+		r_rig.add_bone(side + "Foot", side + "LowerLeg", Vector3(0.0f, -0.45f, 0.0f));
+		r_rig.add_pin(side + "Hand");
+		r_rig.add_pin(side + "Foot");
+	}
+	r_rig.add_pin("Head");
+	r_rig.add_pin("Hips");
+	r_rig.build("Hips");
+}
+
+void build_spider(BenchmarkRig &r_rig, int32_t p_leg_count) {
+	r_rig.add_bone("Body", "", Vector3(0.0f, 0.5f, 0.0f));
+	for (int32_t leg_i = 0; leg_i < p_leg_count; leg_i++) {
+		const Vector3 out = Basis(Vector3(0.0f, 1.0f, 0.0f), Math_TAU * leg_i / p_leg_count).xform(Vector3(0.15f, 0.0f, 0.0f));
+		String parent = "Body";
+		for (int32_t segment_i = 0; segment_i < 4; segment_i++) {
+			const String name = vformat("Leg%d_%d", leg_i, segment_i);
+			r_rig.add_bone(name, parent, segment_i < 2 ? out + Vector3(0.0f, 0.05f, 0.0f) : out * 0.5f + Vector3(0.0f, -0.2f, 0.0f));
+			parent = name;
+		}
+		r_rig.add_pin(parent);
+	}
+	r_rig.add_pin("Body");
+	r_rig.build("Body");
+}
+
+void build_tail(BenchmarkRig &r_rig, int32_t p_bone_count) {
+	r_rig.add_bone("Hips", "", Vector3(0.0f, 1.0f, 0.0f));
+	for (int32_t bone_i = 0; bone_i < p_bone_count; bone_i++) {
+		r_rig.add_bone(vformat("Tail%d", bone_i), bone_i ? vformat("Tail%d", bone_i - 1) : String("Hips"), Vector3(0.0f, 0.0f, -0.05f));
+	}
+	r_rig.add_pin("Hips");
+	r_rig.add_pin(vformat("Tail%d", p_bone_count - 1));
+	r_rig.build("Hips");
+}
+
+void benchmark_segment_solver(const String &p_name, BenchmarkRig &r_rig) {
+	int64_t frame = 0;
+	const real_t damp = Math::deg_to_rad(15.0f);
+	run_benchmark(vformat("segment_solver %s (%d bones, %d effectors)", p_name, r_rig.bone_list.size(), r_rig.effectors.size()), 1, [&]() {
+		r_rig.move_targets(frame++);
+		r_rig.segmented_skeleton->segment_solver(damp);
+	});
+}
+
+// Solves from the rest pose toward p_target_sets different target poses and returns the mean number of iterations until
+// every pin is within p_tolerance, giving up after p_max_iterations.
+double iterations_to_tolerance(BenchmarkRig &r_rig, real_t p_initial_damp, real_t p_damp, int32_t p_schedule_iterations, real_t p_tolerance, int32_t p_max_iterations, int32_t p_target_sets) {
+	int64_t total_iterations = 0;
+	for (int32_t set_i = 0; set_i < p_target_sets; set_i++) {
+		r_rig.reset_pose();
+		r_rig.move_targets(set_i * 37);
+		int32_t iteration_i = 0;
+		while (iteration_i < p_max_iterations && r_rig.segmented_skeleton->get_residual_error() > p_tolerance) {
+			r_rig.segmented_skeleton->segment_solver(IKBoneSegment::get_scheduled_damp(p_initial_damp, p_damp, iteration_i, p_schedule_iterations));
+			iteration_i++;
+		}
+		total_iterations += iteration_i;
+	}
+	return double(total_iterations) / p_target_sets;
+}
+
+TEST_CASE("[Modules][EWBIK][Benchmark] QCP weighted superpose" * doctest::skip()) {
+	RandomPCG rng(42);
+	for (int32_t heading_count : { 7, 14, 35, 70, 140 }) {
+		PackedVector3Array moved;
+		PackedVector3Array target;
+		Vector<real_t> weights;
+		const Quaternion rotation(Vector3(1.0f, 2.0f, 3.0f).normalized(), 0.8f);
+		for (int32_t heading_i = 0; heading_i < heading_count; heading_i++) {
+			const Vector3 heading = Vector3(rng.randf() - 0.5f, rng.randf() - 0.5f, rng.randf() - 0.5f);
+			moved.push_back(heading);
+			target.push_back(rotation.xform(heading));
+			weights.push_back(rng.randf() + 0.5f);
+		}
+		QCP qcp(1E-6, 1E-11);
+		for (bool translate : { false, true }) {
+			run_benchmark(vformat("QCP::weighted_superpose %d headings%s", heading_count, translate ? ", translated" : ""), 1, [&]() {
+				_ALLOW_DISCARD_ qcp.weighted_superpose(moved, target, weights, translate);
+			});
+		}
+	}
+}
+
+TEST_CASE("[Modules][EWBIK][Benchmark] segment solver on synthetic rigs" * doctest::skip()) {
+	for (int32_t bone_count : { 2, 5, 10, 25, 50, 100, 200 }) {
+		BenchmarkRig rig;
+		build_chain(rig, bone_count);
+		benchmark_segment_solver("chain", rig);
+	}
+	{
+		BenchmarkRig rig;
+		build_humanoid(rig);
+		benchmark_segment_solver("humanoid", rig);
+	}
+	{
+		BenchmarkRig rig;
+		build_spider(rig, 8);
+		benchmark_segment_solver("spider", rig);
+	}
+	{
+		BenchmarkRig rig;
+		build_tail(rig, 64);
+		benchmark_segment_solver("tail", rig);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK][Benchmark] iterations to tolerance with a damp schedule" * doctest::skip()) {
+	// The schedule shrinks from the initial damp to the default 15 degrees over the default 10 iterations. Zero is the
+	// constant damp the solver used before.
+	const real_t damp = Math::deg_to_rad(15.0f);
+	const real_t tolerance = 1e-4f;
+	for (const String &rig_name : { String("chain"), String("humanoid"), String("spider"), String("tail") }) {
+		BenchmarkRig rig;
+		if (rig_name == "chain") {
+			build_chain(rig, 25);
+		} else if (rig_name == "humanoid") {
+			build_humanoid(rig);
+		} else if (rig_name == "spider") {
+			build_spider(rig, 8);
+		} else {
+			build_tail(rig, 64);
+		}
+		for (real_t initial_degrees : { 0.0f, 30.0f, 60.0f, 90.0f }) {
+			const double iterations = iterations_to_tolerance(rig, Math::deg_to_rad(initial_degrees), damp, 10, tolerance, 100, 32);
+			print_line(vformat("[EWBIK benchmark] iterations to tolerance %s, initial damp %d degrees: %.2f.", rig_name, int32_t(initial_degrees), iterations));
+		}
+	}
+}
+
+TEST_CASE("[Modules][EWBIK][Benchmark] kusudama orientation snap" * doctest::skip()) {
+	for (int32_t cone_count : { 1, 2, 5, 10, 20, 30 }) {
+		BenchmarkRig rig;
+		build_chain(rig, 2);
+		Ref<IKBone3D> bone = rig.segmented_skeleton->get_ik_bone(rig.skeleton->find_bone("Bone1"));
+		REQUIRE(bone.is_valid());
+		Ref<IKKusudama> constraint = memnew(IKKusudama(bone));
+		constraint->enable_orientational_limits();
+		// A ring of small cones around +Y, so a bone pointing down is always outside and always snaps.
+		for (int32_t cone_i = 0; cone_i < cone_count; cone_i++) {
+			const Vector3 center = Basis(Vector3(0.0f, 1.0f, 0.0f), Math_TAU * cone_i / cone_count).xform(Vector3(0.5f, 1.0f, 0.0f).normalized());
+			constraint->add_limit_cone_at_index(cone_i, center, Math::deg_to_rad(10.0f));
+		}
+		constraint->_update_constraint();
+		const Transform3D outside = Transform3D(Basis(Vector3(1.0f, 0.0f, 0.0f), Math_PI * 0.9f), bone->get_ik_transform()->get_transform().origin);
+		Ref<IKTransform3D> ik_transform = bone->get_ik_transform();
+		Ref<IKTransform3D> constraint_transform = bone->get_constraint_transform();
+		// Includes resetting the bone outside the limits before each snap.
+		run_benchmark(vformat("IKKusudama::set_axes_to_orientation_snap %d cones", cone_count), 1, [&]() {
+			ik_transform->set_transform(outside);
+			constraint->set_axes_to_orientation_snap(ik_transform, constraint_transform, 0.0, bone->get_cos_half_dampen());
+		});
+	}
+}
+
+TEST_CASE("[Modules][EWBIK][Benchmark] IKTransform3D propagation" * doctest::skip()) {
+	for (int32_t depth : { 1, 8, 32, 128 }) {
+		Vector<Ref<IKTransform3D>> chain;
+		for (int32_t transform_i = 0; transform_i < depth; transform_i++) {
+			Ref<IKTransform3D> transform;
+			transform.instantiate();
+			transform->set_transform(Transform3D(Basis(Vector3(0.0f, 0.0f, 1.0f), 0.1f), Vector3(0.0f, 0.1f, 0.0f)));
+			if (transform_i) {
+				transform->set_parent(chain[transform_i - 1]);
+			}
+			chain.push_back(transform);
+		}
+		int64_t frame = 0;
+		// Dirtying the root and reading the leaf recomputes every global transform in between.
+		run_benchmark(vformat("IKTransform3D root change + leaf read, depth %d", depth), 1, [&]() {
+			chain.write[0]->set_transform(Transform3D(Basis(Vector3(0.0f, 1.0f, 0.0f), (frame++ % 64) * 0.01f), Vector3()));
+			_ALLOW_DISCARD_ chain[depth - 1]->get_global_transform();
+		});
+		run_benchmark(vformat("IKTransform3D::to_local, depth %d", depth), 1, [&]() {
+			_ALLOW_DISCARD_ chain[depth - 1]->to_local(Vector3(1.0f, 2.0f, 3.0f));
+		});
+	}
+}
+} // namespace TestEWBIKBenchmark
+
+#endif